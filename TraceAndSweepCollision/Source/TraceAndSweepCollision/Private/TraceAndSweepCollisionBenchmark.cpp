@@ -0,0 +1,627 @@
+#include "TraceAndSweepCollisionBenchmark.h"
+#include "TraceAndSweepCollisionTypes.h"
+#include "TraceAndSweepCollisionComponent.h"
+#include "TraceAndSweepCollisionManager.h"
+#include "TraceAndSweepCollisionSubsystem.h"
+
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/MemoryBase.h"
+#include "Components/BoxComponent.h"
+#include "Engine/World.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/AutomationTest.h"
+#include "Engine/Engine.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogTraceAndSweepCollisionBenchmark, Log, All);
+
+namespace
+{
+	// Obstacle field layout, cubes in a grid on XY plane with components moving along the rows
+	constexpr float obstacle_half_extent = 50.0f;
+	constexpr float obstacle_spacing = 400.0f;
+	constexpr float component_speed = 1200.0f;
+	// Radius of sweep sphere and distance of the two line points from component
+	constexpr float shape_radius = 10.0f;
+	constexpr float line_point_offset = 20.0f;
+	// Frames to wait after the measured ones for async traces to come back, before giving up on them
+	constexpr int32 max_drain_frames = 60;
+
+	float PingPong(float distance, float length)
+	{
+		const float position = FMath::Fmod(distance, 2.0f * length);
+		return position < length ? position : 2.0f * length - position;
+	}
+
+	template<typename TEnum>
+	FString GetEnumName(TEnum value)
+	{
+		return StaticEnum<TEnum>()->GetNameStringByValue(int64(value));
+	}
+}
+
+TWeakObjectPtr<UTraceAndSweepCollisionBenchmarkRunner> UTraceAndSweepCollisionBenchmarkRunner::s_active_runner;
+TArray<FString> UTraceAndSweepCollisionBenchmarkRunner::s_last_result_rows;
+
+bool UTraceAndSweepCollisionBenchmarkRunner::Run(UWorld* world, const FSettings& settings)
+{
+	if (s_active_runner.IsValid())
+	{
+		UE_LOG(LogTraceAndSweepCollisionBenchmark, Warning, TEXT("Benchmark is already running"));
+		return false;
+	}
+
+	if (!world || !world->IsGameWorld())
+	{
+		UE_LOG(LogTraceAndSweepCollisionBenchmark, Warning, TEXT("Benchmark needs a game world"));
+		return false;
+	}
+
+	s_last_result_rows.Reset();
+
+	UTraceAndSweepCollisionBenchmarkRunner* runner = NewObject<UTraceAndSweepCollisionBenchmarkRunner>();
+	runner->AddToRoot();
+	if (!runner->Start(world, settings))
+	{
+		runner->RemoveFromRoot();
+		return false;
+	}
+
+	s_active_runner = runner;
+	return true;
+}
+
+bool UTraceAndSweepCollisionBenchmarkRunner::Start(UWorld* world, const FSettings& settings)
+{
+	m_world = world;
+	m_settings = settings;
+
+	UTraceAndSweepCollisionSubsystem* subsystem = world->GetSubsystem<UTraceAndSweepCollisionSubsystem>();
+	m_manager = subsystem ? subsystem->GetManager() : nullptr;
+	if (!m_manager.IsValid())
+	{
+		UE_LOG(LogTraceAndSweepCollisionBenchmark, Warning, TEXT("No manager in this world"));
+		return false;
+	}
+	m_was_manager_ticking = m_manager->IsActorTickEnabled();
+	m_manager->SetActorTickEnabled(false);
+
+	for (ECollisionCompExecutionType execution_type : { ECollisionCompExecutionType::SYNCHRONOUS, ECollisionCompExecutionType::ASYNCHRONOUS })
+	{
+		for (ECollisionCompStyleType style_type : { ECollisionCompStyleType::LINE, ECollisionCompStyleType::SWEEP })
+		{
+			for (ECollisionCompTraceType trace_type : { ECollisionCompTraceType::SINGLE, ECollisionCompTraceType::MULTI })
+			{
+				m_combinations.Add({ execution_type, style_type, trace_type, ECollisionCompEndOverlapType::REVERSE_TRACE });
+
+				// Forward diff is only allowed for multi sweeps
+				if (style_type == ECollisionCompStyleType::SWEEP && trace_type == ECollisionCompTraceType::MULTI)
+				{
+					m_combinations.Add({ execution_type, style_type, trace_type, ECollisionCompEndOverlapType::FORWARD_DIFF });
+				}
+			}
+		}
+	}
+
+	SpawnObstacles();
+
+	m_rows.Add(TEXT("execution,style,trace,end_overlap,manager_mode,components,frames,collision_tests_per_frame,traces_per_frame,traces_per_second,game_thread_ns_per_trace,process_allocations_per_tick,hit_events,end_overlap_events,mean_hit_latency_ms"));
+
+	m_ticker_handle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &UTraceAndSweepCollisionBenchmarkRunner::Tick));
+	return true;
+}
+
+void UTraceAndSweepCollisionBenchmarkRunner::Finish()
+{
+	FTSTicker::GetCoreTicker().RemoveTicker(m_ticker_handle);
+
+	if (m_combination_index >= m_combinations.Num())
+	{
+		s_last_result_rows = m_rows;
+	}
+
+	DestroyComponents();
+	for (AActor* obstacle : m_obstacles)
+	{
+		if (IsValid(obstacle))
+		{
+			obstacle->Destroy();
+		}
+	}
+	m_obstacles.Reset();
+
+	if (m_manager.IsValid())
+	{
+		m_manager->SetActorTickEnabled(m_was_manager_ticking);
+	}
+
+	const FString csv_path = m_settings.m_csv_path.IsEmpty()
+		? FPaths::ProfilingDir() / TEXT("TraceAndSweepCollision") / FString::Printf(TEXT("Benchmark-%s.csv"), *FDateTime::Now().ToString())
+		: m_settings.m_csv_path;
+
+	if (FFileHelper::SaveStringArrayToFile(m_rows, *csv_path))
+	{
+		UE_LOG(LogTraceAndSweepCollisionBenchmark, Display, TEXT("Benchmark results written to %s"), *csv_path);
+	}
+	else
+	{
+		UE_LOG(LogTraceAndSweepCollisionBenchmark, Warning, TEXT("Failed to write benchmark results to %s"), *csv_path);
+	}
+
+	s_active_runner.Reset();
+	RemoveFromRoot();
+}
+
+bool UTraceAndSweepCollisionBenchmarkRunner::Tick(float delta_time)
+{
+	if (!m_world.IsValid() || !m_manager.IsValid())
+	{
+		UE_LOG(LogTraceAndSweepCollisionBenchmark, Warning, TEXT("World or manager went away, benchmark stopped early"));
+		Finish();
+		return false;
+	}
+
+	if (m_frame == 0)
+	{
+		SpawnComponents(m_combinations[m_combination_index]);
+		m_measurement = FMeasurement();
+	}
+
+	const int32 num_measured_end_frame = m_settings.m_num_warmup_frames + m_settings.m_num_frames;
+	const bool is_measured = m_frame >= m_settings.m_num_warmup_frames && m_frame < num_measured_end_frame;
+
+	if (m_frame == m_settings.m_num_warmup_frames)
+	{
+		m_measurement.m_start_counters = GetTelemetryCounters();
+		m_measurement.m_start_seconds = FPlatformTime::Seconds();
+	}
+
+	// After the measured frames components stop moving and the manager is only ticked to hand out results of traces still in flight
+	m_run_seconds += delta_time;
+	if (m_frame < num_measured_end_frame)
+	{
+		MoveComponents();
+	}
+	TickManager(delta_time, is_measured);
+
+	++m_frame;
+	if (m_frame < num_measured_end_frame)
+	{
+		return true;
+	}
+
+	if (m_frame == num_measured_end_frame)
+	{
+		for (UTraceAndSweepCollisionComponent* comp : m_components)
+		{
+			if (IsValid(comp))
+			{
+				comp->SetIsTraceCollisionEnabled(false);
+			}
+		}
+	}
+
+	// Async rows are timed until every trace started in the measured frames came back, not only until they were started
+	if (GetNumPendingAsyncTraces() > 0)
+	{
+		if (m_frame < num_measured_end_frame + max_drain_frames)
+		{
+			return true;
+		}
+		UE_LOG(LogTraceAndSweepCollisionBenchmark, Warning, TEXT("Async traces didn't come back within %d frames, their row is incomplete"), max_drain_frames);
+	}
+
+	m_measurement.m_wall_seconds = FPlatformTime::Seconds() - m_measurement.m_start_seconds;
+	m_measurement.m_end_counters = GetTelemetryCounters();
+
+	AddResultRow(m_combinations[m_combination_index]);
+	DestroyComponents();
+	m_frame = 0;
+
+	if (++m_combination_index < m_combinations.Num())
+	{
+		return true;
+	}
+
+	Finish();
+	return false;
+}
+
+void UTraceAndSweepCollisionBenchmarkRunner::SpawnObstacles()
+{
+	UWorld* world = m_world.Get();
+
+	m_num_grid_columns = FMath::CeilToInt(FMath::Sqrt(float(m_settings.m_num_obstacles)));
+	m_num_grid_rows = FMath::DivideAndRoundUp(m_settings.m_num_obstacles, m_num_grid_columns);
+
+	for (int32 index = 0; index < m_settings.m_num_obstacles; ++index)
+	{
+		const FVector location((index % m_num_grid_columns) * obstacle_spacing, (index / m_num_grid_columns) * obstacle_spacing, 0.0f);
+
+		AActor* obstacle = world->SpawnActor<AActor>();
+		UBoxComponent* box = NewObject<UBoxComponent>(obstacle);
+		box->SetBoxExtent(FVector(obstacle_half_extent), false);
+		box->SetCollisionObjectType(ECC_WorldDynamic);
+		box->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
+		box->SetCollisionResponseToAllChannels(ECR_Overlap);
+		box->SetWorldLocation(location);
+		obstacle->SetRootComponent(box);
+		box->RegisterComponent();
+
+		m_obstacles.Add(obstacle);
+	}
+}
+
+void UTraceAndSweepCollisionBenchmarkRunner::SpawnComponents(const FCombination& combination)
+{
+	UWorld* world = m_world.Get();
+
+	for (int32 index = 0; index < m_settings.m_num_components; ++index)
+	{
+		AActor* owner = world->SpawnActor<AActor>();
+		UTraceAndSweepCollisionComponent* comp = NewObject<UTraceAndSweepCollisionComponent>(owner);
+
+		// Set before registering, component reads these in BeginPlay
+		comp->m_execution_type = combination.m_execution_type;
+		comp->m_style_type = combination.m_style_type;
+		comp->m_trace_type = combination.m_trace_type;
+		comp->m_end_overlap_type = combination.m_end_overlap_type;
+		comp->m_traces_per_second = 0.0f;
+		comp->m_channel_type = ECollisionCompChannelType::OBJECT_CHANNEL;
+		comp->m_object_channels = { UEngineTypes::ConvertToObjectType(ECC_WorldDynamic) };
+		comp->m_debug_draw_collision_shape = false;
+		comp->m_debug_draw_trace_lines = false;
+		comp->m_debug_draw_sweep_shape = false;
+		comp->m_draw_debug_hit_point = false;
+
+		if (combination.m_style_type == ECollisionCompStyleType::SWEEP)
+		{
+			FCollisionShapeData shape_data;
+			shape_data.m_shape_type = ECollisionCompShapeType::SPHERE;
+			shape_data.m_sphere_radius = shape_radius;
+			comp->m_collision_shape_data.Add(shape_data);
+		}
+
+		comp->OnComponentBeginOverlap.AddDynamic(this, &UTraceAndSweepCollisionBenchmarkRunner::OnBeginOverlap);
+		owner->SetRootComponent(comp);
+		comp->RegisterComponent();
+
+		if (combination.m_style_type == ECollisionCompStyleType::LINE)
+		{
+			for (float offset : { -line_point_offset, line_point_offset })
+			{
+				USceneComponent* point = NewObject<USceneComponent>(owner);
+				point->SetupAttachment(comp);
+				point->SetRelativeLocation(FVector(0.0f, offset, 0.0f));
+				point->RegisterComponent();
+				comp->AddSceneComponentToTrace(point);
+			}
+		}
+
+		m_components.Add(comp);
+	}
+
+	m_entry_seconds.Init(0.0, m_components.Num());
+	m_is_inside_obstacle.Init(false, m_components.Num());
+	MoveComponents();
+
+	// Components start where they are instead of sweeping from origin
+	for (UTraceAndSweepCollisionComponent* comp : m_components)
+	{
+		comp->SetIsTraceCollisionEnabled(true);
+	}
+}
+
+void UTraceAndSweepCollisionBenchmarkRunner::DestroyComponents()
+{
+	for (UTraceAndSweepCollisionComponent* comp : m_components)
+	{
+		if (IsValid(comp) && comp->GetOwner())
+		{
+			comp->GetOwner()->Destroy();
+		}
+	}
+
+	m_components.Reset();
+	m_entry_seconds.Reset();
+	m_is_inside_obstacle.Reset();
+}
+
+void UTraceAndSweepCollisionBenchmarkRunner::MoveComponents()
+{
+	const float lane_length = (m_num_grid_columns - 1) * obstacle_spacing;
+	const float inside_distance = obstacle_half_extent + (m_components.Num() > 0 && m_components[0]->m_style_type == ECollisionCompStyleType::SWEEP ? shape_radius : 0.0f);
+	const double now_seconds = FPlatformTime::Seconds();
+
+	for (int32 index = 0; index < m_components.Num(); ++index)
+	{
+		UTraceAndSweepCollisionComponent* comp = m_components[index];
+		if (!IsValid(comp)) continue;
+
+		// Spread along the lane so that components don't enter obstacles on the same frame
+		const int32 row = index % m_num_grid_rows;
+		const float start_distance = FMath::Frac(index * 0.6180339887f) * 2.0f * lane_length;
+		const float x = PingPong(start_distance + float(m_run_seconds) * component_speed, FMath::Max(lane_length, 1.0f));
+		comp->GetOwner()->SetActorLocation(FVector(x, row * obstacle_spacing, 0.0f));
+
+		const int32 column = FMath::RoundToInt(x / obstacle_spacing);
+		const bool has_obstacle = row * m_num_grid_columns + column < m_obstacles.Num();
+		const bool is_inside = has_obstacle && FMath::Abs(x - column * obstacle_spacing) < inside_distance;
+
+		if (is_inside && !m_is_inside_obstacle[index])
+		{
+			m_entry_seconds[index] = now_seconds;
+		}
+		m_is_inside_obstacle[index] = is_inside;
+	}
+}
+
+void UTraceAndSweepCollisionBenchmarkRunner::TickManager(float delta_time, bool is_measured)
+{
+	// Counts allocations of every thread, benchmark world should be otherwise idle for it to mean anything
+#if !UE_BUILD_SHIPPING
+	const uint64 start_allocations = FMalloc::TotalMallocCalls + FMalloc::TotalReallocCalls;
+#endif
+	const uint64 start_cycles = FPlatformTime::Cycles64();
+
+	m_manager->Tick(delta_time);
+	// Batch overlapped with other worlds would otherwise be dispatched at end of frame, outside of the timed part
+	m_manager->FinishPendingBatch();
+
+	const uint64 end_cycles = FPlatformTime::Cycles64();
+
+	if (is_measured)
+	{
+		m_measurement.m_tick_seconds += FPlatformTime::ToSeconds64(end_cycles - start_cycles);
+#if !UE_BUILD_SHIPPING
+		m_measurement.m_num_allocations += FMalloc::TotalMallocCalls + FMalloc::TotalReallocCalls - start_allocations;
+#endif
+	}
+}
+
+FCollisionTelemetryCounters UTraceAndSweepCollisionBenchmarkRunner::GetTelemetryCounters() const
+{
+	if (m_components.Num() > 0 && IsValid(m_components[0]))
+	{
+		if (const FCollisionTelemetryCounters* counters = m_components[0]->GetTelemetryCounters())
+		{
+			return *counters;
+		}
+	}
+	return FCollisionTelemetryCounters();
+}
+
+int32 UTraceAndSweepCollisionBenchmarkRunner::GetNumPendingAsyncTraces() const
+{
+	int32 num_pending = 0;
+	for (const UTraceAndSweepCollisionComponent* comp : m_components)
+	{
+		if (IsValid(comp))
+		{
+			num_pending += comp->m_num_pending_async_traces.load();
+		}
+	}
+	return num_pending;
+}
+
+void UTraceAndSweepCollisionBenchmarkRunner::AddResultRow(const FCombination& combination)
+{
+	const ATraceAndSweepCollisionManager* manager = m_manager.Get();
+	const TCHAR* manager_mode = manager->m_use_trace_pool ? TEXT("Pooled") : manager->m_use_batched_execution ? TEXT("Batched") : TEXT("PerComponent");
+
+	const FMeasurement& measurement = m_measurement;
+	const int32 num_frames = FMath::Max(1, m_settings.m_num_frames);
+
+	// Counted by the components themselves, so components that weren't due, were culled or were resolved analytically don't count
+	const int64 num_collision_tests = measurement.m_end_counters.m_num_collision_tests - measurement.m_start_counters.m_num_collision_tests;
+	const int64 num_traces = measurement.m_end_counters.m_num_traces - measurement.m_start_counters.m_num_traces;
+	const int64 num_end_overlaps = measurement.m_end_counters.m_num_end_overlaps - measurement.m_start_counters.m_num_end_overlaps;
+
+	// Sync traces are done when the manager tick returns. Async ones run alongside the rest of the frame, so they are timed
+	// from first measured frame until the last of them came back, which includes the rest of those frames too.
+	const bool is_async = combination.m_execution_type == ECollisionCompExecutionType::ASYNCHRONOUS;
+	const double trace_seconds = is_async ? measurement.m_wall_seconds : measurement.m_tick_seconds;
+	const double traces_per_second = trace_seconds > 0.0 ? num_traces / trace_seconds : 0.0;
+	const double ns_per_trace = num_traces > 0 ? measurement.m_tick_seconds * 1.0e9 / num_traces : 0.0;
+	const double mean_latency_ms = measurement.m_num_latency_samples > 0 ? measurement.m_latency_seconds * 1.0e3 / measurement.m_num_latency_samples : 0.0;
+
+	const FString row = FString::Printf(TEXT("%s,%s,%s,%s,%s,%d,%d,%.1f,%.1f,%.0f,%.2f,%.2f,%d,%lld,%.3f"),
+		*GetEnumName(combination.m_execution_type),
+		*GetEnumName(combination.m_style_type),
+		*GetEnumName(combination.m_trace_type),
+		*GetEnumName(combination.m_end_overlap_type),
+		manager_mode,
+		m_components.Num(),
+		num_frames,
+		double(num_collision_tests) / num_frames,
+		double(num_traces) / num_frames,
+		traces_per_second,
+		ns_per_trace,
+		double(measurement.m_num_allocations) / num_frames,
+		measurement.m_num_hit_events,
+		num_end_overlaps,
+		mean_latency_ms);
+
+	UE_LOG(LogTraceAndSweepCollisionBenchmark, Display, TEXT("%s"), *row);
+	m_rows.Add(row);
+}
+
+void UTraceAndSweepCollisionBenchmarkRunner::OnBeginOverlap(UPrimitiveComponent* overlapped_component, AActor* other_actor, UPrimitiveComponent* other_component, int32 other_body_index, bool from_sweep, const FHitResult& sweep_result)
+{
+	const int32 index = m_components.IndexOfByKey(overlapped_component);
+	if (index == INDEX_NONE) return;
+
+	const double entry_seconds = m_entry_seconds[index];
+	m_entry_seconds[index] = 0.0;
+
+	if (m_frame < m_settings.m_num_warmup_frames) return;
+
+	m_measurement.m_num_hit_events++;
+
+	// Latency is from the frame component moved into the obstacle to its begin overlap
+	if (entry_seconds > 0.0)
+	{
+		m_measurement.m_latency_seconds += FPlatformTime::Seconds() - entry_seconds;
+		m_measurement.m_num_latency_samples++;
+	}
+}
+
+#if !UE_BUILD_SHIPPING
+
+namespace TraceAndSweepCollisionBenchmark
+{
+	// Runs the same steps a component does every collision test (collect forward and reverse hits, begin overlaps and then end overlaps)
+	// with given number of simultaneous overlaps and returns average time per hit in nanoseconds.
+	double MeasureHitSetPerHitCost(const TArray<FHitResult>& hits, int32 iterations)
+	{
+		FCollisionHitSet forward_hit_results;
+		FCollisionHitSet reverse_hit_results;
+		FCollisionHitSet overlapped_results;
+
+		const uint64 start_cycles = FPlatformTime::Cycles64();
+		for (int32 iteration = 0; iteration < iterations; ++iteration)
+		{
+			forward_hit_results.Reset();
+			reverse_hit_results.Reset();
+
+			for (const FHitResult& hit : hits)
+			{
+				forward_hit_results.AddUnique(hit);
+				reverse_hit_results.AddUnique(hit);
+			}
+
+			for (const FCollisionHitEntry& entry : forward_hit_results.GetEntries())
+			{
+				bool is_new_overlap = false;
+				overlapped_results.FindOrAdd(entry.m_key, entry.m_record, is_new_overlap).m_count++;
+			}
+
+			for (const FCollisionHitEntry& entry : reverse_hit_results.GetEntries())
+			{
+				overlapped_results.Release(entry.m_key);
+			}
+		}
+		const uint64 end_cycles = FPlatformTime::Cycles64();
+
+		const double total_ns = FPlatformTime::ToSeconds64(end_cycles - start_cycles) * 1.0e9;
+		return total_ns / (double(iterations) * FMath::Max(1, hits.Num()));
+	}
+
+	// TraceAndSweepCollision.BenchmarkHitSet [max_overlaps] [iterations]
+	// Prints per hit cost of overlap tracking for 1 up to max_overlaps simultaneous overlaps.
+	void BenchmarkHitSet(const TArray<FString>& args)
+	{
+		const int32 max_overlaps = args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*args[0])) : 1000;
+		const int32 iterations = args.Num() > 1 ? FMath::Max(1, FCString::Atoi(*args[1])) : 200;
+
+		UE_LOG(LogTraceAndSweepCollisionBenchmark, Display, TEXT("overlaps,ns_per_hit"));
+
+		for (int32 num_overlaps = 1; num_overlaps <= max_overlaps; num_overlaps *= 10)
+		{
+			// Item is part of the key, so hits with different items are different overlaps
+			TArray<FHitResult> hits;
+			hits.SetNum(num_overlaps);
+			for (int32 i = 0; i < num_overlaps; ++i)
+			{
+				hits[i].Item = i;
+				hits[i].Distance = 1.0f;
+				hits[i].bBlockingHit = true;
+			}
+
+			const double ns_per_hit = MeasureHitSetPerHitCost(hits, iterations);
+			UE_LOG(LogTraceAndSweepCollisionBenchmark, Display, TEXT("%d,%.2f"), num_overlaps, ns_per_hit);
+		}
+	}
+
+	static FAutoConsoleCommand BenchmarkHitSetCommand(
+		TEXT("TraceAndSweepCollision.BenchmarkHitSet"),
+		TEXT("Measures per hit cost of overlap tracking from 1 to N simultaneous overlaps. Usage: TraceAndSweepCollision.BenchmarkHitSet [max_overlaps] [iterations]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkHitSet));
+
+	// TraceAndSweepCollision.BenchmarkModes [components] [frames] [obstacles] [csv_path]
+	// Headless: -game -nullrhi -ExecCmds="TraceAndSweepCollision.BenchmarkModes 256 300"
+	void BenchmarkModes(const TArray<FString>& args, UWorld* world)
+	{
+		UTraceAndSweepCollisionBenchmarkRunner::FSettings settings;
+		settings.m_num_components = args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*args[0])) : settings.m_num_components;
+		settings.m_num_frames = args.Num() > 1 ? FMath::Max(1, FCString::Atoi(*args[1])) : settings.m_num_frames;
+		settings.m_num_obstacles = args.Num() > 2 ? FMath::Max(1, FCString::Atoi(*args[2])) : settings.m_num_obstacles;
+		settings.m_csv_path = args.Num() > 3 ? args[3] : FString();
+
+		UTraceAndSweepCollisionBenchmarkRunner::Run(world, settings);
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs BenchmarkModesCommand(
+		TEXT("TraceAndSweepCollision.BenchmarkModes"),
+		TEXT("Runs N components of every execution, style, trace and end overlap type combination through a field of obstacles and writes traces per second, game thread ns per trace, allocations per tick and hit event latency as CSV. Usage: TraceAndSweepCollision.BenchmarkModes [components] [frames] [obstacles] [csv_path]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&BenchmarkModes));
+}
+
+#endif
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace TraceAndSweepCollisionBenchmark
+{
+	UWorld* FindGameWorld()
+	{
+		if (!GEngine) return nullptr;
+
+		for (const FWorldContext& context : GEngine->GetWorldContexts())
+		{
+			if ((context.WorldType == EWorldType::Game || context.WorldType == EWorldType::PIE) && context.World())
+			{
+				return context.World();
+			}
+		}
+		return nullptr;
+	}
+}
+
+// Waits for the runner and reports its rows on the test, fails if it stopped before every combination ran
+DEFINE_LATENT_AUTOMATION_COMMAND_ONE_PARAMETER(FTraceAndSweepCollisionWaitForBenchmark, FAutomationTestBase*, m_test);
+
+bool FTraceAndSweepCollisionWaitForBenchmark::Update()
+{
+	if (UTraceAndSweepCollisionBenchmarkRunner::IsRunning()) return false;
+
+	const TArray<FString>& rows = UTraceAndSweepCollisionBenchmarkRunner::GetLastResultRows();
+	if (rows.Num() == 0)
+	{
+		m_test->AddError(TEXT("Benchmark stopped early, see LogTraceAndSweepCollisionBenchmark"));
+		return true;
+	}
+
+	for (const FString& row : rows)
+	{
+		m_test->AddInfo(row);
+	}
+	return true;
+}
+
+// Headless: -game -nullrhi -ExecCmds="Automation RunTests TraceAndSweepCollision.Benchmark.Modes; Quit"
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTraceAndSweepCollisionBenchmarkModesTest, "TraceAndSweepCollision.Benchmark.Modes",
+	EAutomationTestFlags::ClientContext | EAutomationTestFlags::PerfFilter)
+
+bool FTraceAndSweepCollisionBenchmarkModesTest::RunTest(const FString& parameters)
+{
+	UWorld* world = TraceAndSweepCollisionBenchmark::FindGameWorld();
+	if (!world)
+	{
+		AddError(TEXT("Benchmark needs a game world, run it with -game or in PIE"));
+		return false;
+	}
+
+	if (!UTraceAndSweepCollisionBenchmarkRunner::Run(world, UTraceAndSweepCollisionBenchmarkRunner::FSettings()))
+	{
+		AddError(TEXT("Benchmark couldn't start, see LogTraceAndSweepCollisionBenchmark"));
+		return false;
+	}
+
+	ADD_LATENT_AUTOMATION_COMMAND(FTraceAndSweepCollisionWaitForBenchmark(this));
+	return true;
+}
+
+#endif
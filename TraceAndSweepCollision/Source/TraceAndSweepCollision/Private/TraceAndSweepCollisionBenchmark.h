@@ -0,0 +1,117 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "Containers/Ticker.h"
+#include "TraceAndSweepCollisionTypes.h"
+#include "TraceAndSweepCollisionTelemetry.h"
+#include "TraceAndSweepCollisionBenchmark.generated.h"
+
+class ATraceAndSweepCollisionManager;
+class UTraceAndSweepCollisionComponent;
+
+// Runs every execution, style, trace and end overlap type combination of the component over a field of obstacles for a number of frames each
+// and writes the results as CSV. Started from TraceAndSweepCollision.BenchmarkModes or the TraceAndSweepCollision.Benchmark.Modes automation test,
+// works with -nullrhi so it can run headless.
+UCLASS(Transient)
+class UTraceAndSweepCollisionBenchmarkRunner : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	struct FSettings
+	{
+		int32 m_num_components = 256;
+		int32 m_num_frames = 300;
+		// Frames skipped after spawning, so registration and first allocations don't count
+		int32 m_num_warmup_frames = 30;
+		int32 m_num_obstacles = 1024;
+		FString m_csv_path;
+	};
+
+	// Returns false if a benchmark is already running or there is no game world
+	static bool Run(UWorld* world, const FSettings& settings);
+
+	static FORCEINLINE bool IsRunning() { return s_active_runner.IsValid(); }
+	// Rows of the last run that finished, header first. Empty if it stopped early.
+	static FORCEINLINE const TArray<FString>& GetLastResultRows() { return s_last_result_rows; }
+
+private:
+	struct FCombination
+	{
+		ECollisionCompExecutionType m_execution_type = ECollisionCompExecutionType::SYNCHRONOUS;
+		ECollisionCompStyleType m_style_type = ECollisionCompStyleType::LINE;
+		ECollisionCompTraceType m_trace_type = ECollisionCompTraceType::SINGLE;
+		ECollisionCompEndOverlapType m_end_overlap_type = ECollisionCompEndOverlapType::REVERSE_TRACE;
+	};
+
+	// Totals of the measured frames of one combination
+	struct FMeasurement
+	{
+		// Game thread time of manager ticks
+		double m_tick_seconds = 0.0;
+		// From start of first measured frame until every trace started in the measured frames has come back
+		double m_start_seconds = 0.0;
+		double m_wall_seconds = 0.0;
+		uint64 m_num_allocations = 0;
+		// Telemetry counters of the components at start of measured frames and once their traces came back
+		FCollisionTelemetryCounters m_start_counters;
+		FCollisionTelemetryCounters m_end_counters;
+		int32 m_num_hit_events = 0;
+		int32 m_num_latency_samples = 0;
+		double m_latency_seconds = 0.0;
+	};
+
+	bool Start(UWorld* world, const FSettings& settings);
+	void Finish();
+	bool Tick(float delta_time);
+
+	void SpawnObstacles();
+	void SpawnComponents(const FCombination& combination);
+	void DestroyComponents();
+
+	// Moves components back and forth along their lane through the obstacles, and remembers when each one moved into an obstacle
+	void MoveComponents();
+	// Manager is ticked here instead of by the world, so that only its work is measured
+	void TickManager(float delta_time, bool is_measured);
+
+	// Counters of the archetype every component of the benchmark shares, since their owners are all plain actors
+	FCollisionTelemetryCounters GetTelemetryCounters() const;
+	int32 GetNumPendingAsyncTraces() const;
+
+	void AddResultRow(const FCombination& combination);
+
+	UFUNCTION()
+	void OnBeginOverlap(UPrimitiveComponent* overlapped_component, AActor* other_actor, UPrimitiveComponent* other_component, int32 other_body_index, bool from_sweep, const FHitResult& sweep_result);
+
+	static TWeakObjectPtr<UTraceAndSweepCollisionBenchmarkRunner> s_active_runner;
+	static TArray<FString> s_last_result_rows;
+
+	TWeakObjectPtr<UWorld> m_world;
+	TWeakObjectPtr<ATraceAndSweepCollisionManager> m_manager;
+	bool m_was_manager_ticking = true;
+	FSettings m_settings;
+	FTSTicker::FDelegateHandle m_ticker_handle;
+
+	TArray<FCombination> m_combinations;
+	int32 m_combination_index = 0;
+	int32 m_frame = 0;
+	double m_run_seconds = 0.0;
+
+	// Obstacles are in a grid, components move along the rows of the grid
+	int32 m_num_grid_columns = 0;
+	int32 m_num_grid_rows = 0;
+
+	UPROPERTY()
+	TArray<AActor*> m_obstacles;
+
+	UPROPERTY()
+	TArray<UTraceAndSweepCollisionComponent*> m_components;
+
+	// Time component moved into an obstacle, 0 when not waiting for its begin overlap
+	TArray<double> m_entry_seconds;
+	TArray<bool> m_is_inside_obstacle;
+
+	FMeasurement m_measurement;
+	TArray<FString> m_rows;
+};
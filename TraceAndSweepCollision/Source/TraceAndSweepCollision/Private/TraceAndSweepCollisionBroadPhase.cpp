@@ -0,0 +1,212 @@
+#include "TraceAndSweepCollisionBroadPhase.h"
+
+#include "Components/PrimitiveComponent.h"
+#include "Components/BoxComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/SphereComponent.h"
+
+
+namespace
+{
+	// Padding targets are placed far outside of the world so that they can never be hit
+	constexpr float padding_bound = 1.0e30f;
+
+	// Used in place of 1/0 for axis segment doesn't move along. Large enough to push slab times outside of [0, 1], small enough not to make NaN.
+	constexpr float max_inv_direction = 1.0e30f;
+
+	FCollisionTargetShape MakeTargetShape(const UPrimitiveComponent* target)
+	{
+		FCollisionTargetShape shape;
+		shape.m_center = target->GetComponentLocation();
+		shape.m_rotation = target->GetComponentQuat();
+
+		if (const UBoxComponent* box = Cast<UBoxComponent>(target))
+		{
+			shape.m_is_simple_shape = true;
+			shape.m_shape_type = ECollisionCompShapeType::BOX;
+			shape.m_extent = box->GetScaledBoxExtent();
+		}
+		else if (const UCapsuleComponent* capsule = Cast<UCapsuleComponent>(target))
+		{
+			const float radius = capsule->GetScaledCapsuleRadius();
+			shape.m_is_simple_shape = true;
+			shape.m_shape_type = ECollisionCompShapeType::CAPSULE;
+			shape.m_extent = FVector(radius, radius, capsule->GetScaledCapsuleHalfHeight());
+		}
+		else if (const USphereComponent* sphere = Cast<USphereComponent>(target))
+		{
+			shape.m_is_simple_shape = true;
+			shape.m_shape_type = ECollisionCompShapeType::SPHERE;
+			shape.m_extent = FVector(sphere->GetScaledSphereRadius());
+		}
+
+		return shape;
+	}
+
+	FVector3f GetSafeInvDirection(const FVector3f& direction)
+	{
+		return FVector3f(
+			FMath::Abs(direction.X) > UE_KINDA_SMALL_NUMBER ? 1.0f / direction.X : max_inv_direction,
+			FMath::Abs(direction.Y) > UE_KINDA_SMALL_NUMBER ? 1.0f / direction.Y : max_inv_direction,
+			FMath::Abs(direction.Z) > UE_KINDA_SMALL_NUMBER ? 1.0f / direction.Z : max_inv_direction);
+	}
+}
+
+
+void FCollisionBroadPhase::AddTarget(UPrimitiveComponent* target)
+{
+	if (target)
+	{
+		m_targets.AddUnique(target);
+	}
+}
+
+// Removed targets are only cleared here and dropped on next UpdateTargets, so that indices stay same until then
+void FCollisionBroadPhase::RemoveTarget(UPrimitiveComponent* target)
+{
+	const int32 index = m_targets.Find(target);
+	if (index != INDEX_NONE)
+	{
+		m_targets[index].Reset();
+	}
+}
+
+void FCollisionBroadPhase::RemoveAllTargets()
+{
+	for (TWeakObjectPtr<UPrimitiveComponent>& target : m_targets)
+	{
+		target.Reset();
+	}
+}
+
+void FCollisionBroadPhase::UpdateTargets()
+{
+	// Drop targets that were removed or destroyed since last update
+	for (int32 index = m_targets.Num() - 1; index >= 0; --index)
+	{
+		if (!m_targets[index].IsValid())
+		{
+			m_targets.RemoveAtSwap(index, 1, EAllowShrinking::No);
+		}
+	}
+
+	const int32 num_targets = m_targets.Num();
+	const int32 num_padded = Align(num_targets, 4);
+
+	m_shapes.SetNum(num_targets, EAllowShrinking::No);
+
+	m_min_x.SetNumUninitialized(num_padded, EAllowShrinking::No);
+	m_min_y.SetNumUninitialized(num_padded, EAllowShrinking::No);
+	m_min_z.SetNumUninitialized(num_padded, EAllowShrinking::No);
+	m_max_x.SetNumUninitialized(num_padded, EAllowShrinking::No);
+	m_max_y.SetNumUninitialized(num_padded, EAllowShrinking::No);
+	m_max_z.SetNumUninitialized(num_padded, EAllowShrinking::No);
+
+	for (int32 index = 0; index < num_targets; ++index)
+	{
+		const UPrimitiveComponent* target = m_targets[index].Get();
+		m_shapes[index] = MakeTargetShape(target);
+
+		const FBox box = target->Bounds.GetBox();
+		m_min_x[index] = box.Min.X;
+		m_min_y[index] = box.Min.Y;
+		m_min_z[index] = box.Min.Z;
+		m_max_x[index] = box.Max.X;
+		m_max_y[index] = box.Max.Y;
+		m_max_z[index] = box.Max.Z;
+	}
+
+	for (int32 index = num_targets; index < num_padded; ++index)
+	{
+		m_min_x[index] = m_min_y[index] = m_min_z[index] = padding_bound;
+		m_max_x[index] = m_max_y[index] = m_max_z[index] = padding_bound;
+	}
+}
+
+bool FCollisionBroadPhase::OverlapsAnyTarget(const FVector& start, const FVector& end, float radius) const
+{
+	const FVector3f start_f(start);
+	const FVector3f inv_direction = GetSafeInvDirection(FVector3f(end - start));
+
+	for (int32 first_target = 0; first_target < m_min_x.Num(); first_target += 4)
+	{
+		if (TestFourTargets(first_target, start_f, inv_direction, radius) != 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool FCollisionBroadPhase::OverlapsAnyTarget(const FBox& box) const
+{
+	const VectorRegister4Float box_min_x = VectorSetFloat1(box.Min.X);
+	const VectorRegister4Float box_min_y = VectorSetFloat1(box.Min.Y);
+	const VectorRegister4Float box_min_z = VectorSetFloat1(box.Min.Z);
+	const VectorRegister4Float box_max_x = VectorSetFloat1(box.Max.X);
+	const VectorRegister4Float box_max_y = VectorSetFloat1(box.Max.Y);
+	const VectorRegister4Float box_max_z = VectorSetFloat1(box.Max.Z);
+
+	for (int32 first_target = 0; first_target < m_min_x.Num(); first_target += 4)
+	{
+		// Boxes overlap when they overlap on every axis
+		VectorRegister4Float overlap = VectorBitwiseAnd(VectorCompareLE(VectorLoad(&m_min_x[first_target]), box_max_x), VectorCompareGE(VectorLoad(&m_max_x[first_target]), box_min_x));
+		overlap = VectorBitwiseAnd(overlap, VectorBitwiseAnd(VectorCompareLE(VectorLoad(&m_min_y[first_target]), box_max_y), VectorCompareGE(VectorLoad(&m_max_y[first_target]), box_min_y)));
+		overlap = VectorBitwiseAnd(overlap, VectorBitwiseAnd(VectorCompareLE(VectorLoad(&m_min_z[first_target]), box_max_z), VectorCompareGE(VectorLoad(&m_max_z[first_target]), box_min_z)));
+
+		if (VectorMaskBits(overlap) != 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void FCollisionBroadPhase::GatherCandidates(const FVector& start, const FVector& end, float radius, FCollisionCandidateArray& out_candidates) const
+{
+	const FVector3f start_f(start);
+	const FVector3f inv_direction = GetSafeInvDirection(FVector3f(end - start));
+
+	for (int32 first_target = 0; first_target < m_min_x.Num(); first_target += 4)
+	{
+		int32 mask = TestFourTargets(first_target, start_f, inv_direction, radius);
+		while (mask != 0)
+		{
+			const int32 lane = FMath::CountTrailingZeros(uint32(mask));
+			out_candidates.Add(first_target + lane);
+			mask &= mask - 1;
+		}
+	}
+}
+
+int32 FCollisionBroadPhase::TestFourTargets(int32 first_target, const FVector3f& start, const FVector3f& inv_direction, float radius) const
+{
+	// Slab test of segment start + t * direction, t in [0, 1] against 4 boxes inflated by radius
+	const VectorRegister4Float inflate = VectorSetFloat1(radius);
+
+	VectorRegister4Float t_near = VectorZeroFloat();
+	VectorRegister4Float t_far = VectorOneFloat();
+
+	auto test_axis = [&](const TArray<float>& mins, const TArray<float>& maxs, float origin_value, float inv_value)
+	{
+		const VectorRegister4Float origin = VectorSetFloat1(origin_value);
+		const VectorRegister4Float inv = VectorSetFloat1(inv_value);
+
+		const VectorRegister4Float box_min = VectorSubtract(VectorLoad(&mins[first_target]), inflate);
+		const VectorRegister4Float box_max = VectorAdd(VectorLoad(&maxs[first_target]), inflate);
+
+		const VectorRegister4Float t1 = VectorMultiply(VectorSubtract(box_min, origin), inv);
+		const VectorRegister4Float t2 = VectorMultiply(VectorSubtract(box_max, origin), inv);
+
+		t_near = VectorMax(t_near, VectorMin(t1, t2));
+		t_far = VectorMin(t_far, VectorMax(t1, t2));
+	};
+
+	test_axis(m_min_x, m_max_x, start.X, inv_direction.X);
+	test_axis(m_min_y, m_max_y, start.Y, inv_direction.Y);
+	test_axis(m_min_z, m_max_z, start.Z, inv_direction.Z);
+
+	return VectorMaskBits(VectorCompareLE(t_near, t_far));
+}
@@ -1,10 +1,22 @@
 #include "TraceAndSweepCollisionComponent.h"
 #include "TraceAndSweepDebugDraw.h"
 #include "TraceAndSweepCollisionManager.h"
+#include "TraceAndSweepCollisionSubsystem.h"
+#include "TraceAndSweepCollisionBroadPhase.h"
+#include "TraceAndSweepCollisionNarrowPhase.h"
+#include "TraceAndSweepCollisionTelemetry.h"
 
-#include "EngineUtils.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/GameViewportClient.h"
+#include "Engine/OverlapResult.h"
+#include "Engine/SkinnedAsset.h"
+#include "Misc/ScopeExit.h"
+#include "PrimitiveSceneProxy.h"
+#include "RenderingThread.h"
 
 
+DEFINE_LOG_CATEGORY_STATIC(LogTraceAndSweepCollisionComponent, Log, All);
+
 //For Unreal Profiler 
 DECLARE_CYCLE_STAT(TEXT("DoCollisionTest"), STAT_DoCollisionTest, STATGROUP_TraceAndSweepCollisionComponent);
 DECLARE_CYCLE_STAT(TEXT("DoSynchronousLineSingleCollisionTest"), STAT_DoSynchronousLineSingleCollisionTest, STATGROUP_TraceAndSweepCollisionComponent);
@@ -13,19 +25,323 @@ DECLARE_CYCLE_STAT(TEXT("DoSynchronousLineMultiCollisionTest"), STAT_DoSynchrono
 DECLARE_CYCLE_STAT(TEXT("DoSynchronousSweepMultiCollisionTest"), STAT_DoSynchronousSweepMultiCollisionTest, STATGROUP_TraceAndSweepCollisionComponent);
 DECLARE_CYCLE_STAT(TEXT("DoAsynchronousLineCollisionTest"), STAT_DoAsynchronousLineCollisionTest, STATGROUP_TraceAndSweepCollisionComponent);
 DECLARE_CYCLE_STAT(TEXT("DoAsynchronousSweepCollisionTest"), STAT_DoAsynchronousSweepCollisionTest, STATGROUP_TraceAndSweepCollisionComponent);
+DECLARE_CYCLE_STAT(TEXT("RetraceAsyncCollisionTest"), STAT_RetraceAsyncCollisionTest, STATGROUP_TraceAndSweepCollisionComponent);
 
 DECLARE_CYCLE_STAT(TEXT("GetDynamicMeshElements"), STAT_TraceAndSweepCollisionSceneProxy_GetDynamicMeshElements, STATGROUP_TraceAndSweepCollisionComponent);
 
+DECLARE_DWORD_COUNTER_STAT(TEXT("Broad Phase Culled Segments"), STAT_BroadPhaseCulledSegments, STATGROUP_TraceAndSweepCollisionComponent);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Analytic Narrow Phase Segments"), STAT_AnalyticNarrowPhaseSegments, STATGROUP_TraceAndSweepCollisionComponent);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Forward Traces"), STAT_ForwardTraces, STATGROUP_TraceAndSweepCollisionComponent);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Reverse Traces"), STAT_ReverseTraces, STATGROUP_TraceAndSweepCollisionComponent);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Start Overlap Queries"), STAT_StartOverlapQueries, STATGROUP_TraceAndSweepCollisionComponent);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Retraced Async Collision Tests"), STAT_RetracedAsyncCollisionTests, STATGROUP_TraceAndSweepCollisionComponent);
+
+
+// Copy of everything the scene proxy draws, made on game thread and handed over whole so render thread never reads the component
+struct FCollisionDebugLine
+{
+	FVector m_start = FVector::ZeroVector;
+	FVector m_end = FVector::ZeroVector;
+};
 
-UTraceAndSweepCollisionComponent::FHitResultWrapper::FHitResultWrapper(const FHitResult& result) :
-	m_result(result)
-{}
+struct FCollisionDebugRenderData
+{
+	// World space, so drawing is one batch of lines per view
+	TArray<FCollisionDebugLine> m_lines;
+	FColor m_color = FColor::Blue;
+	float m_thickness = 0.0f;
+};
 
-bool UTraceAndSweepCollisionComponent::FHitResultWrapper::operator==(const FHitResultWrapper& rhs) const
+namespace
 {
-	return m_result.GetActor() == rhs.m_result.GetActor()
-		&& m_result.GetComponent() == rhs.m_result.GetComponent()
-		&& m_result.Item == rhs.m_result.Item;
+	constexpr int32 debug_circle_segments = 24;
+
+	void AddArcLines(TArray<FCollisionDebugLine>& lines, const FVector& center, const FVector& x, const FVector& y, float radius, float start_angle, float end_angle, int32 num_segments)
+	{
+		const float angle_step = (end_angle - start_angle) / num_segments;
+		FVector previous = center + (x * FMath::Cos(start_angle) + y * FMath::Sin(start_angle)) * radius;
+
+		for (int32 index = 1; index <= num_segments; ++index)
+		{
+			const float angle = start_angle + angle_step * index;
+			const FVector current = center + (x * FMath::Cos(angle) + y * FMath::Sin(angle)) * radius;
+			lines.Add({ previous, current });
+			previous = current;
+		}
+	}
+
+	// Six arrows pointing at the point from each side, same as DrawDirectionalArrow with arrow size of 2
+	void AddPointArrowLines(TArray<FCollisionDebugLine>& lines, const FTransform& transform, float arrow_length)
+	{
+		constexpr float middle_gap = 1.0f;
+		constexpr float arrow_size = 2.0f;
+
+		const FVector axes[3] = { transform.GetUnitAxis(EAxis::X), transform.GetUnitAxis(EAxis::Y), transform.GetUnitAxis(EAxis::Z) };
+		const FVector point = transform.GetLocation();
+
+		for (int32 axis = 0; axis < 3; ++axis)
+		{
+			const FVector& side_a = axes[(axis + 1) % 3];
+			const FVector& side_b = axes[(axis + 2) % 3];
+
+			for (const float sign : { -1.0f, 1.0f })
+			{
+				const FVector direction = axes[axis] * sign;
+				const FVector tail = point + direction * (arrow_length + middle_gap);
+				const FVector tip = point + direction * middle_gap;
+				lines.Add({ tail, tip });
+
+				const FVector head_base = tip + direction * arrow_size;
+				lines.Add({ tip, head_base + (side_a + side_b) * arrow_size });
+				lines.Add({ tip, head_base + (side_a - side_b) * arrow_size });
+				lines.Add({ tip, head_base - (side_a + side_b) * arrow_size });
+				lines.Add({ tip, head_base - (side_a - side_b) * arrow_size });
+			}
+		}
+	}
+
+	// Extent is scaled by transform
+	void AddBoxLines(TArray<FCollisionDebugLine>& lines, const FTransform& transform, const FVector& extent)
+	{
+		FVector corners[8];
+		for (int32 index = 0; index < 8; ++index)
+		{
+			const FVector local(index & 1 ? extent.X : -extent.X, index & 2 ? extent.Y : -extent.Y, index & 4 ? extent.Z : -extent.Z);
+			corners[index] = transform.TransformPosition(local);
+		}
+
+		// Corners that differ in one bit share an edge
+		for (int32 index = 0; index < 8; ++index)
+		{
+			for (const int32 bit : { 1, 2, 4 })
+			{
+				if (!(index & bit))
+				{
+					lines.Add({ corners[index], corners[index | bit] });
+				}
+			}
+		}
+	}
+
+	void AddSphereLines(TArray<FCollisionDebugLine>& lines, const FVector& center, const FQuat& rotation, float radius)
+	{
+		const FVector x = rotation.GetAxisX();
+		const FVector y = rotation.GetAxisY();
+		const FVector z = rotation.GetAxisZ();
+
+		AddArcLines(lines, center, x, y, radius, 0.0f, UE_TWO_PI, debug_circle_segments);
+		AddArcLines(lines, center, x, z, radius, 0.0f, UE_TWO_PI, debug_circle_segments);
+		AddArcLines(lines, center, y, z, radius, 0.0f, UE_TWO_PI, debug_circle_segments);
+	}
+
+	// Half height includes the hemispheres, same as DrawWireCapsule
+	void AddCapsuleLines(TArray<FCollisionDebugLine>& lines, const FVector& center, const FQuat& rotation, float radius, float half_height)
+	{
+		const FVector x = rotation.GetAxisX();
+		const FVector y = rotation.GetAxisY();
+		const FVector z = rotation.GetAxisZ();
+
+		const float cylinder_half_height = FMath::Max(half_height - radius, 0.0f);
+		const FVector top = center + z * cylinder_half_height;
+		const FVector bottom = center - z * cylinder_half_height;
+
+		AddArcLines(lines, top, x, y, radius, 0.0f, UE_TWO_PI, debug_circle_segments);
+		AddArcLines(lines, bottom, x, y, radius, 0.0f, UE_TWO_PI, debug_circle_segments);
+
+		AddArcLines(lines, top, x, z, radius, 0.0f, UE_PI, debug_circle_segments / 2);
+		AddArcLines(lines, top, y, z, radius, 0.0f, UE_PI, debug_circle_segments / 2);
+		AddArcLines(lines, bottom, x, z, radius, UE_PI, UE_TWO_PI, debug_circle_segments / 2);
+		AddArcLines(lines, bottom, y, z, radius, UE_PI, UE_TWO_PI, debug_circle_segments / 2);
+
+		lines.Add({ top + x * radius, bottom + x * radius });
+		lines.Add({ top - x * radius, bottom - x * radius });
+		lines.Add({ top + y * radius, bottom + y * radius });
+		lines.Add({ top - y * radius, bottom - y * radius });
+	}
+
+	/** Represents a UTraceAndSweepCollisionComponent to the scene manager. */
+	class FTraceAndSweepCollisionSceneProxy final : public FPrimitiveSceneProxy
+	{
+	public:
+		SIZE_T GetTypeHash() const override
+		{
+			static size_t UniquePointer;
+			return reinterpret_cast<size_t>(&UniquePointer);
+		}
+
+		FTraceAndSweepCollisionSceneProxy(const UTraceAndSweepCollisionComponent* comp, TUniquePtr<FCollisionDebugRenderData> render_data)
+			: FPrimitiveSceneProxy(comp)
+			, m_render_data(MoveTemp(render_data))
+		{
+			bWillEverBeLit = false;
+			bWantsSelectionOutline = true;
+			//bAlwaysVisible = true;
+		}
+
+		void SetRenderData_RenderThread(TUniquePtr<FCollisionDebugRenderData> render_data)
+		{
+			check(IsInRenderingThread());
+			m_render_data = MoveTemp(render_data);
+		}
+
+		virtual void GetDynamicMeshElements(const TArray<const FSceneView*>& Views, const FSceneViewFamily& ViewFamily, uint32 VisibilityMap, FMeshElementCollector& Collector) const override
+		{
+			SCOPE_CYCLE_COUNTER(STAT_TraceAndSweepCollisionSceneProxy_GetDynamicMeshElements);
+
+			if (!m_render_data || m_render_data->m_lines.Num() == 0) return;
+
+			const bool is_thick = m_render_data->m_thickness > 0.0f;
+
+			for (int32 ViewIndex = 0; ViewIndex < Views.Num(); ViewIndex++)
+			{
+				if (VisibilityMap & (1 << ViewIndex))
+				{
+					const FSceneView* View = Views[ViewIndex];
+
+					const FLinearColor color = GetViewSelectionColor(m_render_data->m_color, *View, IsSelected(), IsHovered(), false, IsIndividuallySelected());
+					FPrimitiveDrawInterface* PDI = Collector.GetPDI(ViewIndex);
+
+					PDI->AddReserveLines(SDPG_World, m_render_data->m_lines.Num(), false, is_thick);
+					for (const FCollisionDebugLine& line : m_render_data->m_lines)
+					{
+						PDI->DrawLine(line.m_start, line.m_end, color, SDPG_World, m_render_data->m_thickness);
+					}
+				}
+			}
+		}
+
+		virtual FPrimitiveViewRelevance GetViewRelevance(const FSceneView* View) const override
+		{
+			bool bDrawOnlyIfSelected = false;
+			const bool bProxyVisible = !bDrawOnlyIfSelected || IsSelected();
+
+			// Should we draw this because collision drawing is enabled, and we have collision
+			const bool bShowForCollision = View->Family->EngineShowFlags.Collision;
+
+			FPrimitiveViewRelevance Result;
+			Result.bDrawRelevance = (IsShown(View) && bProxyVisible) || bShowForCollision;
+			Result.bDynamicRelevance = true;
+			Result.bShadowRelevance = IsShadowCast(View);
+			Result.bEditorPrimitiveRelevance = UseEditorCompositing(View);
+			return Result;
+		}
+		virtual uint32 GetMemoryFootprint(void) const override
+		{
+			const uint32 render_data_size = m_render_data ? m_render_data->m_lines.GetAllocatedSize() : 0;
+			return(sizeof(*this) + FPrimitiveSceneProxy::GetAllocatedSize() + render_data_size);
+		}
+
+	private:
+		TUniquePtr<FCollisionDebugRenderData> m_render_data;
+	};
+
+	// Half extent of the shape as it is used for sweeping. Capsule is (radius, radius, half height) and sphere is radius on all axis.
+	FVector GetShapeExtent(const FCollisionShapeData& shape_data)
+	{
+		if (shape_data.m_shape_type == ECollisionCompShapeType::BOX)
+		{
+			return shape_data.m_box_half_extent;
+		}
+		else if (shape_data.m_shape_type == ECollisionCompShapeType::CAPSULE)
+		{
+			return FVector(shape_data.m_capsule_radius, shape_data.m_capsule_radius, shape_data.m_capsule_half_height);
+		}
+		else if (shape_data.m_shape_type == ECollisionCompShapeType::SPHERE)
+		{
+			return FVector(shape_data.m_sphere_radius);
+		}
+
+		return FVector::ZeroVector;
+	}
+
+	FCollisionShape MakeCollisionShape(const FCollisionShapeData& shape_data)
+	{
+		if (shape_data.m_shape_type == ECollisionCompShapeType::BOX)
+		{
+			return FCollisionShape::MakeBox(shape_data.m_box_half_extent);
+		}
+		else if (shape_data.m_shape_type == ECollisionCompShapeType::CAPSULE)
+		{
+			return FCollisionShape::MakeCapsule(shape_data.m_capsule_radius, shape_data.m_capsule_half_height);
+		}
+		else if (shape_data.m_shape_type == ECollisionCompShapeType::SPHERE)
+		{
+			return FCollisionShape::MakeSphere(shape_data.m_sphere_radius);
+		}
+
+		return FCollisionShape();
+	}
+
+	// World bounds of one shape under component transform
+	FBox CalcShapeBounds(const FCollisionShapeData& shape, const FTransform& comp_transform)
+	{
+		FTransform total_world_transform = shape.m_offset * comp_transform;
+
+		if (shape.m_shape_type == ECollisionCompShapeType::BOX)
+		{
+			return FBox(-shape.m_box_half_extent, shape.m_box_half_extent).TransformBy(total_world_transform);
+		}
+		else if (shape.m_shape_type == ECollisionCompShapeType::CAPSULE)
+		{
+			// For capsule just construct a box around capsule and calculate bounds of the box
+			// Capsule has constraints:
+			//		Scale on X and Y axis should be same.
+			//		Radius cannot exceed half height after scaling both radius and half height
+			// Scale is applied here so that constraints can be imposed.
+			const FVector world_scale = total_world_transform.GetScale3D();
+			double capsule_radius = shape.m_capsule_radius * FMath::Max(FMath::Abs(world_scale.X), FMath::Abs(world_scale.Y));
+			double half_height = shape.m_capsule_half_height * FMath::Abs(world_scale.Z);
+			capsule_radius = FMath::Clamp(capsule_radius, 0.0, half_height);	//cap radius based on total height
+			half_height = FMath::Max(capsule_radius, half_height);
+
+			// Since scale is already being considered for calculating radius and height, remove it
+			total_world_transform.SetScale3D(FVector::OneVector);
+
+			const FVector capsule_extent = FVector(capsule_radius, capsule_radius, half_height);
+			return FBox(-capsule_extent, capsule_extent).TransformBy(total_world_transform);
+		}
+		else if (shape.m_shape_type == ECollisionCompShapeType::SPHERE)
+		{
+			// NOTE: Rotation doesn't matter for sphere
+			const float world_scale = total_world_transform.GetScale3D().GetAbsMax();
+			const float effective_radius = shape.m_sphere_radius * world_scale;
+
+			return FBox::BuildAABB(total_world_transform.GetLocation(), FVector(effective_radius));
+		}
+
+		return FBox(ForceInit);
+	}
+
+	// Sweeps shape against every candidate and adds a blocking hit for each one touched, nearest first. Only nearest one is kept if is_single.
+	void SweepAnalyticCandidates(const FCollisionBroadPhase& broad_phase, TConstArrayView<int32> candidates, const TraceAndSweepNarrowPhase::FSweptShape& shape, const FVector& start, const FVector& end, bool is_single, TArray<FHitResult>& out_hits)
+	{
+		const int32 first_hit = out_hits.Num();
+
+		for (const int32 candidate : candidates)
+		{
+			TraceAndSweepNarrowPhase::FSweepHit sweep_hit;
+			if (!TraceAndSweepNarrowPhase::Sweep(shape, start, end, broad_phase.GetTargetShape(candidate), sweep_hit)) continue;
+
+			UPrimitiveComponent* target = broad_phase.GetTarget(candidate).Get();
+
+			FHitResult& hit = out_hits.Emplace_GetRef(target ? target->GetOwner() : nullptr, target, sweep_hit.m_location, sweep_hit.m_normal);
+			hit.bBlockingHit = true;
+			hit.bStartPenetrating = sweep_hit.m_is_start_penetrating;
+			hit.Time = sweep_hit.m_time;
+			hit.Distance = FVector::Dist(start, sweep_hit.m_location);
+			hit.ImpactPoint = sweep_hit.m_impact_point;
+			hit.TraceStart = start;
+			hit.TraceEnd = end;
+		}
+
+		TArrayView<FHitResult> new_hits = MakeArrayView(out_hits).RightChop(first_hit);
+		new_hits.Sort([](const FHitResult& a, const FHitResult& b) { return a.Time < b.Time; });
+
+		if (is_single && new_hits.Num() > 1)
+		{
+			out_hits.SetNum(first_hit + 1, EAllowShrinking::No);
+		}
+	}
 }
 
 
@@ -40,12 +356,25 @@ UTraceAndSweepCollisionComponent::UTraceAndSweepCollisionComponent()
 }
 
 
+void UTraceAndSweepCollisionComponent::OnRegister()
+{
+	// Before Super, which updates the bounds
+	RefreshLocalShapeBounds();
+
+	Super::OnRegister();
+}
+
 // Called when the game starts
 void UTraceAndSweepCollisionComponent::BeginPlay()
 {
 	Super::BeginPlay();
 
-	m_async_trace_delegate.BindUObject(this, &UTraceAndSweepCollisionComponent::OnAsyncTraceComplete);
+	// Set before style or trace type was changed, or from an old asset. Persisting overlaps would end and begin again on every other collision test.
+	if (m_end_overlap_type == ECollisionCompEndOverlapType::FORWARD_DIFF && (m_style_type != ECollisionCompStyleType::SWEEP || m_trace_type != ECollisionCompTraceType::MULTI))
+	{
+		UE_LOG(LogTraceAndSweepCollisionComponent, Warning, TEXT("%s: Forward Diff end overlaps need multi sweeps, using Reverse Trace instead"), *GetPathName());
+		m_end_overlap_type = ECollisionCompEndOverlapType::REVERSE_TRACE;
+	}
 
 	// Add all child scene objects for tracing
 	TArray<USceneComponent*> childern;
@@ -56,20 +385,22 @@ void UTraceAndSweepCollisionComponent::BeginPlay()
 	SetIsTraceCollisionEnabled(m_start_with_collision_enabled);
 	SetTracePerSecond(m_traces_per_second);
 
-	TActorIterator<ATraceAndSweepCollisionManager> ActorItr(GetWorld());
-	if (ActorItr)
+	UTraceAndSweepCollisionSubsystem* subsystem = GetWorld()->GetSubsystem<UTraceAndSweepCollisionSubsystem>();
+	ATraceAndSweepCollisionManager* manager = subsystem ? subsystem->GetManager() : nullptr;
+	if (manager)
 	{
-		(*ActorItr)->RegisterComponent(this);
+		manager->RegisterComponent(this);
+		m_manager = manager;
 	}
 }
 
 void UTraceAndSweepCollisionComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	TActorIterator<ATraceAndSweepCollisionManager> ActorItr(GetWorld());
-	if (ActorItr)
+	if (ATraceAndSweepCollisionManager* manager = m_manager.Get())
 	{
-		(*ActorItr)->UnregisterComponent(this);
+		manager->UnregisterComponent(this);
 	}
+	m_manager.Reset();
 
 	Super::EndPlay(EndPlayReason);
 }
@@ -80,6 +411,11 @@ void UTraceAndSweepCollisionComponent::ExternalTick()
 	{
 		DoCollisionTest();
 	}
+	else if (m_is_trace_collision_enabled && m_execution_type == ECollisionCompExecutionType::ASYNCHRONOUS)
+	{
+		// Every async test in flight is still waiting, next one picks up from here
+		AddStitchPoints();
+	}
 }
 
 void UTraceAndSweepCollisionComponent::TickComponent(float delta_time, ELevelTick tick_type, FActorComponentTickFunction* this_tick_function)
@@ -90,31 +426,56 @@ void UTraceAndSweepCollisionComponent::TickComponent(float delta_time, ELevelTic
 	{
 		DoCollisionTest();
 	}
+	else if (m_is_trace_collision_enabled && m_execution_type == ECollisionCompExecutionType::ASYNCHRONOUS)
+	{
+		AddStitchPoints();
+	}
+}
+
+// Clear out cached results from previous collision test
+void UTraceAndSweepCollisionComponent::ResetCollisionTestResults()
+{
+	m_forward_hit_results.Reset();
+	m_reverse_hit_results.Reset();
+	m_begin_overlap_results.Reset();
 }
 
 bool UTraceAndSweepCollisionComponent::DoCollisionTest()
 {
 	SCOPE_CYCLE_COUNTER(STAT_DoCollisionTest);
+	TRACE_CPUPROFILER_EVENT_SCOPE_TEXT_ON_CHANNEL(*m_telemetry_event_name, TraceAndSweepCollisionChannel);
+
+	const uint64 start_cycles = FPlatformTime::Cycles64();
+	ON_SCOPE_EXIT
+	{
+		// Overlap events can unregister the component, then there is no one to charge
+		if (FCollisionTelemetryCounters* counters = GetTelemetryCounters())
+		{
+			counters->m_seconds += FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - start_cycles);
+		}
+	};
 
-	// Clear out cached results from previous collision test
-	m_forward_hit_results.Empty();
-	m_reverse_hit_results.Empty();
+	ResetCollisionTestResults();
 
 	if (m_execution_type == ECollisionCompExecutionType::SYNCHRONOUS && m_style_type == ECollisionCompStyleType::LINE && m_trace_type == ECollisionCompTraceType::SINGLE)
 	{
-		return DoSynchronousLineSingleCollisionTest();
+		SCOPE_CYCLE_COUNTER(STAT_DoSynchronousLineSingleCollisionTest);
+		return DoSynchronousCollisionTest();
 	}
 	else if (m_execution_type == ECollisionCompExecutionType::SYNCHRONOUS && m_style_type == ECollisionCompStyleType::SWEEP && m_trace_type == ECollisionCompTraceType::SINGLE)
 	{
-		return DoSynchronousSweepSingleCollisionTest();
+		SCOPE_CYCLE_COUNTER(STAT_DoSynchronousSweepSingleCollisionTest);
+		return DoSynchronousCollisionTest();
 	}
 	else if (m_execution_type == ECollisionCompExecutionType::SYNCHRONOUS && m_style_type == ECollisionCompStyleType::LINE && m_trace_type == ECollisionCompTraceType::MULTI)
 	{
-		return DoSynchronousLineMultiCollisionTest();
+		SCOPE_CYCLE_COUNTER(STAT_DoSynchronousLineMultiCollisionTest);
+		return DoSynchronousCollisionTest();
 	}
 	else if (m_execution_type == ECollisionCompExecutionType::SYNCHRONOUS && m_style_type == ECollisionCompStyleType::SWEEP && m_trace_type == ECollisionCompTraceType::MULTI)
 	{
-		return DoSynchronousSweepMultiCollisionTest();
+		SCOPE_CYCLE_COUNTER(STAT_DoSynchronousSweepMultiCollisionTest);
+		return DoSynchronousCollisionTest();
 	}
 	else if (m_execution_type == ECollisionCompExecutionType::ASYNCHRONOUS && m_style_type == ECollisionCompStyleType::LINE)
 	{
@@ -129,388 +490,911 @@ bool UTraceAndSweepCollisionComponent::DoCollisionTest()
 }
 
 #pragma region Synchronous
-bool UTraceAndSweepCollisionComponent::DoSynchronousLineSingleCollisionTest()
+bool UTraceAndSweepCollisionComponent::DoSynchronousCollisionTest()
 {
-	SCOPE_CYCLE_COUNTER(STAT_DoSynchronousLineSingleCollisionTest);
-
 	UWorld* world = GetWorld();
 	if (!world) return false;
 
 	m_is_previous_trace_complete = false;
 
-	FCollisionQueryParams params;
-	params.bTraceComplex = m_trace_complex;
-	params.bReturnFaceIndex = m_return_face_index;
-	params.bReturnPhysicalMaterial = m_return_physical_material;
-	params.bIgnoreBlocks = m_ignore_blocks;
-	params.bIgnoreTouches = m_ignore_touches;
-	params.bSkipNarrowPhase = m_skip_narrow_phase;
+	const FCollisionQueryParams& params = GetQueryParams();
 
-	params.AddIgnoredActor(GetOwner());
+	// Scratch buffers keep their memory between collision tests, so there are no allocations once they have grown
+	TArray<FCollisionTraceSegment>& segments = m_scratch_segments;
+	segments.Reset();
+	GatherTraceSegments(segments);
 
-	const USkeletalMeshComponent* parent_skeletal_mesh = Cast<USkeletalMeshComponent>(GetAttachParent());
+	TArray<FHitResult>& forward_hits = m_scratch_forward_hits;
+	TArray<FHitResult>& reverse_hits = m_scratch_reverse_hits;
+	int32 num_traces = 0;
+	for (const FCollisionTraceSegment& segment : segments)
+	{
+		forward_hits.Reset();
+		reverse_hits.Reset();
 
-	for (FCollisionLineData& line_data : m_collision_line_data)
+		num_traces += ExecuteTraceSegment(world, segment, params, forward_hits, reverse_hits);
+		ResolveTraceSegment(world, segment, forward_hits, reverse_hits);
+	}
+
+	if (FCollisionTelemetryCounters* counters = GetTelemetryCounters())
 	{
-		bool valid_line_data = false;
-		FVector start = line_data.m_prev_location;
-		FVector end = start;
+		counters->m_num_traces += num_traces;
+	}
+
+	FinishCollisionTest();
+
+	return true;
+}
+
+const FCollisionQueryParams& UTraceAndSweepCollisionComponent::GetQueryParams()
+{
+	if (!m_are_query_params_dirty) return m_query_params;
+	m_are_query_params_dirty = false;
 
-		if (line_data.m_scene_component_to_follow->IsValidLowLevel())
+	m_query_params = FCollisionQueryParams();
+	m_query_params.bTraceComplex = m_trace_complex;
+	m_query_params.bReturnFaceIndex = m_return_face_index;
+	m_query_params.bReturnPhysicalMaterial = m_return_physical_material;
+	m_query_params.bIgnoreBlocks = m_ignore_blocks;
+	m_query_params.bIgnoreTouches = m_ignore_touches;
+	m_query_params.bSkipNarrowPhase = m_skip_narrow_phase;
+
+	m_query_params.AddIgnoredActor(GetOwner());
+	for (const AActor* actor : m_ignored_actors)
+	{
+		if (IsValid(actor))
 		{
-			end = line_data.m_scene_component_to_follow->GetComponentLocation();
-			valid_line_data = true;
+			m_query_params.AddIgnoredActor(actor);
 		}
-		else if (parent_skeletal_mesh && line_data.m_socket_name != NAME_None && parent_skeletal_mesh->DoesSocketExist(line_data.m_socket_name))
+	}
+	for (const UPrimitiveComponent* component : m_ignored_components)
+	{
+		if (IsValid(component))
 		{
-			end = parent_skeletal_mesh->GetSocketLocation(line_data.m_socket_name);
-			valid_line_data = true;
+			m_query_params.AddIgnoredComponent(component);
 		}
+	}
 
-		if (valid_line_data)
-		{
-			// check for forward hits, these results will be used for begin overlap check
-			FHitResult forward_hit;
-			DoLineSingle(forward_hit, world, start, end, params);
-			if (forward_hit.bBlockingHit)
-			{
-				m_forward_hit_results.AddUnique(forward_hit);
-			}
-
-			if (m_should_generate_end_overlap)
-			{
-				// check for reverse hits, these results will be used for end overlap check
-				TArray<FHitResult> reverse_hits;
-				DoLineMulti(reverse_hits, world, end, start, params, true);
-
-				for (FHitResult& reverse_hit : reverse_hits)
-				{
-					if (reverse_hit.bBlockingHit)
-					{
-						m_reverse_hit_results.AddUnique(reverse_hit);
-					}
-				}
-			}
+	m_object_query_params = FCollisionObjectQueryParams(m_object_channels);
 
-			line_data.m_prev_location = end;
+	return m_query_params;
+}
 
-#if !UE_BUILD_SHIPPING
-			// Draw debug trace line
-			TraceAndSweepDebugDraw::DrawLineTraces(world
-				, start
-				, end
-				, { forward_hit }
-				, m_debug_draw_trace_lines
-				, m_debug_line_color
-				, m_debug_line_duration
-				, m_draw_debug_hit_point
-				, m_debug_hit_normal_color
-				, m_debug_touch_normal_color
-				, m_debug_hit_marker_duration
-				, m_debug_line_thickness);
-#endif
-		}
+void UTraceAndSweepCollisionComponent::RemoveFromPendingBatch()
+{
+	if (ATraceAndSweepCollisionManager* manager = m_manager.Get())
+	{
+		manager->RemoveFromPendingBatch(this);
 	}
+}
 
-	// All hit results are ready to be processed
-	ProcessForwardHitResults();
-
-	if (m_should_generate_end_overlap)
+void UTraceAndSweepCollisionComponent::AddIgnoredActor(AActor* actor)
+{
+	if (actor && !m_ignored_actors.Contains(actor))
 	{
-		ProcessReverseHitResults();
+		RemoveFromPendingBatch();
+		m_ignored_actors.Add(actor);
+		m_are_query_params_dirty = true;
 	}
+}
 
-	m_is_previous_trace_complete = true;
+void UTraceAndSweepCollisionComponent::RemoveIgnoredActor(AActor* actor)
+{
+	if (!m_ignored_actors.Contains(actor)) return;
 
-	return true;
+	RemoveFromPendingBatch();
+	m_ignored_actors.Remove(actor);
+	m_are_query_params_dirty = true;
 }
 
-bool UTraceAndSweepCollisionComponent::DoSynchronousSweepSingleCollisionTest()
+void UTraceAndSweepCollisionComponent::AddIgnoredComponent(UPrimitiveComponent* component)
 {
-	SCOPE_CYCLE_COUNTER(STAT_DoSynchronousSweepSingleCollisionTest);
-
-	UWorld* world = GetWorld();
-	if (!world) return false;
+	if (component && !m_ignored_components.Contains(component))
+	{
+		RemoveFromPendingBatch();
+		m_ignored_components.Add(component);
+		m_are_query_params_dirty = true;
+	}
+}
 
-	m_is_previous_trace_complete = false;
+void UTraceAndSweepCollisionComponent::RemoveIgnoredComponent(UPrimitiveComponent* component)
+{
+	if (!m_ignored_components.Contains(component)) return;
 
-	FCollisionQueryParams params;
-	params.bTraceComplex = m_trace_complex;
-	params.bReturnFaceIndex = m_return_face_index;
-	params.bReturnPhysicalMaterial = m_return_physical_material;
-	params.bIgnoreBlocks = m_ignore_blocks;
-	params.bIgnoreTouches = m_ignore_touches;
-	params.bSkipNarrowPhase = m_skip_narrow_phase;
+	RemoveFromPendingBatch();
+	m_ignored_components.Remove(component);
+	m_are_query_params_dirty = true;
+}
 
-	params.AddIgnoredActor(GetOwner());
+void UTraceAndSweepCollisionComponent::ClearIgnoredActorsAndComponents()
+{
+	RemoveFromPendingBatch();
+	m_ignored_actors.Reset();
+	m_ignored_components.Reset();
+	m_are_query_params_dirty = true;
+}
 
-	FTransform current_comp_transform = GetComponentTransform();
+void UTraceAndSweepCollisionComponent::GatherTraceSegments(TArray<FCollisionTraceSegment>& out_segments)
+{
+	if (m_trace_pool)
+	{
+		WritePoolTransforms();
+		m_trace_pool->SweepSlots(m_pool_slots, out_segments);
+		return;
+	}
 
-	for (FCollisionShapeData& shape_data : m_collision_shape_data)
+	if (m_style_type == ECollisionCompStyleType::LINE)
 	{
-		FVector start = shape_data.m_prev_location;
-		FTransform end_transform = shape_data.m_offset * current_comp_transform;
-		FVector end_location = end_transform.GetLocation();
-		FQuat end_rotation = end_transform.GetRotation();
+		RefreshSocketIndices();
+		const FLinePointSource source = MakeLinePointSource();
 
-		// Forward sweep
-		FHitResult forward_hit;
-		DoSweepSingle(forward_hit, world, start, end_location, end_rotation, shape_data, params);
-		if (forward_hit.bBlockingHit)
+		// Ticks missed while async tests were in flight, traced along the path the points took before the last leg to where they are now
+		for (const FCollisionStitchPoint& point : m_stitch_points)
 		{
-			m_forward_hit_results.AddUnique(forward_hit);
+			if (!m_collision_line_data.IsValidIndex(point.m_data_index)) continue;
+
+			FCollisionLineData& line_data = m_collision_line_data[point.m_data_index];
+			FCollisionTraceSegment& segment = out_segments.AddDefaulted_GetRef();
+			segment.m_data_index = point.m_data_index;
+			segment.m_start = line_data.m_prev_location;
+			segment.m_end = point.m_location;
+
+			line_data.m_prev_location = point.m_location;
 		}
 
-		// Reverse Sweep
-		if (m_should_generate_end_overlap)
+		for (int32 index = 0; index < m_collision_line_data.Num(); ++index)
 		{
-			// check for reverse hits, these results will be used for end overlap check
-			TArray<FHitResult> reverse_hits;
-			DoSweepMulti(reverse_hits, world, end_location, start, shape_data.m_prev_rotation, shape_data, params, true);
-			for (FHitResult& reverse_hit : reverse_hits)
+			FCollisionLineData& line_data = m_collision_line_data[index];
+
+			FVector end = line_data.m_prev_location;
+			if (GetLinePointLocation(line_data, source, end))
 			{
-				if (reverse_hit.bBlockingHit)
-				{
-					m_reverse_hit_results.AddUnique(reverse_hit);
-				}
+				FCollisionTraceSegment& segment = out_segments.AddDefaulted_GetRef();
+				segment.m_data_index = index;
+				segment.m_start = line_data.m_prev_location;
+				segment.m_end = end;
+
+				line_data.m_prev_location = end;
 			}
 		}
+	}
+	else if (m_style_type == ECollisionCompStyleType::SWEEP)
+	{
+		const FTransform current_comp_transform = GetComponentTransform();
+		const FCollisionSubStepSettings sub_step_settings = MakeSubStepSettings();
 
-		shape_data.m_prev_location = end_location;
-		shape_data.m_prev_rotation = end_rotation;
-
-#if !UE_BUILD_SHIPPING
-		if (shape_data.m_shape_type == ECollisionCompShapeType::BOX)
+		for (const FCollisionStitchPoint& point : m_stitch_points)
 		{
-			TraceAndSweepDebugDraw::DrawBoxSweep(world
-				, start
-				, end_location
-				, shape_data.m_box_half_extent
-				, end_rotation
-				, { forward_hit }
-				, m_debug_draw_sweep_shape
-				, m_debug_sweep_shape_color
-				, m_debug_sweep_shape_duration
-				, m_draw_debug_hit_point
-				, m_debug_hit_normal_color
-				, m_debug_touch_normal_color
-				, m_debug_hit_marker_duration
-				, m_debug_line_thickness);
+			if (!m_collision_shape_data.IsValidIndex(point.m_data_index)) continue;
+
+			FCollisionShapeData& shape_data = m_collision_shape_data[point.m_data_index];
+
+			FCollisionTraceSegment segment;
+			segment.m_data_index = point.m_data_index;
+			segment.m_start = shape_data.m_prev_location;
+			segment.m_end = point.m_location;
+			segment.m_start_rotation = shape_data.m_prev_rotation;
+			segment.m_end_rotation = point.m_rotation;
+			segment.m_radius = GetShapeExtent(shape_data).Size();
+			sub_step_settings.AppendSegments(segment, out_segments);
+
+			shape_data.m_prev_location = point.m_location;
+			shape_data.m_prev_rotation = point.m_rotation;
 		}
-		else if (shape_data.m_shape_type == ECollisionCompShapeType::CAPSULE)
+
+		for (int32 index = 0; index < m_collision_shape_data.Num(); ++index)
 		{
-			TraceAndSweepDebugDraw::DrawCapsuleSweep(world
-				, start
-				, end_location
-				, shape_data.m_capsule_half_height
-				, shape_data.m_capsule_radius
-				, end_rotation
-				, { forward_hit }
-				, m_debug_draw_sweep_shape
-				, m_debug_sweep_shape_color
-				, m_debug_sweep_shape_duration
-				, m_draw_debug_hit_point
-				, m_debug_hit_normal_color
-				, m_debug_touch_normal_color
-				, m_debug_hit_marker_duration
-				, m_debug_line_thickness);
+			FCollisionShapeData& shape_data = m_collision_shape_data[index];
+			const FTransform end_transform = shape_data.m_offset * current_comp_transform;
+
+			FCollisionTraceSegment segment;
+			segment.m_data_index = index;
+			segment.m_start = shape_data.m_prev_location;
+			segment.m_end = end_transform.GetLocation();
+			segment.m_start_rotation = shape_data.m_prev_rotation;
+			segment.m_end_rotation = end_transform.GetRotation();
+			segment.m_radius = GetShapeExtent(shape_data).Size();
+			sub_step_settings.AppendSegments(segment, out_segments);
+
+			shape_data.m_prev_location = segment.m_end;
+			shape_data.m_prev_rotation = segment.m_end_rotation;
 		}
-		else if (shape_data.m_shape_type == ECollisionCompShapeType::SPHERE)
+	}
+
+	m_stitch_points.Reset();
+	m_num_stitched_ticks = 0;
+}
+
+void UTraceAndSweepCollisionComponent::RestorePreviousTransform(const FCollisionTraceSegment& segment)
+{
+	// Slots of the pool are in the same order as the lines or shapes
+	if (m_trace_pool)
+	{
+		if (m_pool_slots.IsValidIndex(segment.m_data_index))
 		{
-			TraceAndSweepDebugDraw::DrawSphereSweep(world
-				, start
-				, end_location
-				, shape_data.m_sphere_radius
-				, { forward_hit }
-				, m_debug_draw_sweep_shape
-				, m_debug_sweep_shape_color
-				, m_debug_sweep_shape_duration
-				, m_draw_debug_hit_point
-				, m_debug_hit_normal_color
-				, m_debug_touch_normal_color
-				, m_debug_hit_marker_duration
-				, m_debug_line_thickness);
+			m_trace_pool->SetPrevious(m_pool_slots[segment.m_data_index], segment.m_start, segment.m_start_rotation);
+		}
+		return;
+	}
+
+	if (m_style_type == ECollisionCompStyleType::LINE && m_collision_line_data.IsValidIndex(segment.m_data_index))
+	{
+		m_collision_line_data[segment.m_data_index].m_prev_location = segment.m_start;
+	}
+	else if (m_style_type == ECollisionCompStyleType::SWEEP && m_collision_shape_data.IsValidIndex(segment.m_data_index))
+	{
+		m_collision_shape_data[segment.m_data_index].m_prev_location = segment.m_start;
+		m_collision_shape_data[segment.m_data_index].m_prev_rotation = segment.m_start_rotation;
+	}
+}
+
+int32 UTraceAndSweepCollisionComponent::ExecuteTraceSegment(UWorld* world, const FCollisionTraceSegment& segment, const FCollisionQueryParams& params, TArray<FHitResult>& out_forward_hits, TArray<FHitResult>& out_reverse_hits) const
+{
+	if (!PassesBroadPhase(segment)) return 0;
+
+	if (ExecuteAnalyticSegment(segment, out_forward_hits, out_reverse_hits)) return 0;
+
+	INC_DWORD_STAT(STAT_ForwardTraces);
+	int32 num_traces = 1;
+
+	if (m_style_type == ECollisionCompStyleType::LINE)
+	{
+		// check for forward hits, these results will be used for begin overlap check
+		if (m_trace_type == ECollisionCompTraceType::SINGLE)
+		{
+			FHitResult forward_hit;
+			DoLineSingle(forward_hit, world, segment.m_start, segment.m_end, params);
+			if (forward_hit.bBlockingHit)
+			{
+				out_forward_hits.Add(forward_hit);
+			}
+		}
+		else
+		{
+			DoLineMulti(out_forward_hits, world, segment.m_start, segment.m_end, params);
+		}
+
+		// check for reverse hits, these results will be used for end overlap check
+		if (ShouldTraceReverse())
+		{
+			INC_DWORD_STAT(STAT_ReverseTraces);
+			++num_traces;
+			DoLineMulti(out_reverse_hits, world, segment.m_end, segment.m_start, params, true);
+		}
+	}
+	else if (m_style_type == ECollisionCompStyleType::SWEEP)
+	{
+		const FCollisionShapeData& shape_data = m_collision_shape_data[segment.m_data_index];
+
+		// Forward sweep
+		if (m_trace_type == ECollisionCompTraceType::SINGLE)
+		{
+			FHitResult forward_hit;
+			DoSweepSingle(forward_hit, world, segment.m_start, segment.m_end, segment.m_end_rotation, shape_data, params);
+			if (forward_hit.bBlockingHit)
+			{
+				out_forward_hits.Add(forward_hit);
+			}
+		}
+		else
+		{
+			DoSweepMulti(out_forward_hits, world, segment.m_start, segment.m_end, segment.m_end_rotation, shape_data, params);
+		}
+
+		// Reverse Sweep
+		if (ShouldTraceReverse())
+		{
+			INC_DWORD_STAT(STAT_ReverseTraces);
+			++num_traces;
+			DoSweepMulti(out_reverse_hits, world, segment.m_end, segment.m_start, segment.m_start_rotation, shape_data, params, true);
+		}
+		else if (ShouldQueryStartOverlaps())
+		{
+			++num_traces;
+			AddStartOverlaps(world, segment, shape_data, params, out_forward_hits);
+		}
+	}
+
+	return num_traces;
+}
+
+void UTraceAndSweepCollisionComponent::ResolveTraceSegment(UWorld* world, const FCollisionTraceSegment& segment, TConstArrayView<FHitResult> forward_hits, TConstArrayView<FHitResult> reverse_hits)
+{
+	for (const FHitResult& forward_hit : forward_hits)
+	{
+		if (forward_hit.bBlockingHit)
+		{
+			AddForwardHit(forward_hit);
+		}
+	}
+
+	for (const FHitResult& reverse_hit : reverse_hits)
+	{
+		if (reverse_hit.bBlockingHit)
+		{
+			m_reverse_hit_results.AddUnique(reverse_hit);
 		}
-#endif
+	}
+
+	DrawDebugTrace(world, segment, forward_hits);
+}
+
+void UTraceAndSweepCollisionComponent::FinishCollisionTest()
+{
+	if (FCollisionTelemetryCounters* counters = GetTelemetryCounters())
+	{
+		counters->m_num_collision_tests++;
+		counters->m_num_hits += m_forward_hit_results.Num();
 	}
 
 	// All hit results are ready to be processed
 	ProcessForwardHitResults();
 
-	if (m_should_generate_end_overlap)
+	if (ShouldTraceReverse())
 	{
 		ProcessReverseHitResults();
 	}
+	else if (m_should_generate_end_overlap)
+	{
+		ProcessForwardDiffEndOverlaps();
+	}
 
 	m_is_previous_trace_complete = true;
 
-	return true;
+	// Tracked points can move without the component moving (Eg: sockets of an animated mesh)
+	MarkDebugRenderDataDirty();
 }
+#pragma endregion
 
-bool UTraceAndSweepCollisionComponent::DoSynchronousLineMultiCollisionTest()
+bool UTraceAndSweepCollisionComponent::DoAsynchronousLineCollisionTest()
 {
-	SCOPE_CYCLE_COUNTER(STAT_DoSynchronousLineMultiCollisionTest);
+	SCOPE_CYCLE_COUNTER(STAT_DoAsynchronousLineCollisionTest);
 
 	UWorld* world = GetWorld();
 	if (!world) return false;
 
-	m_is_previous_trace_complete = false;
+	const FCollisionQueryParams& params = GetQueryParams();
+	EAsyncTraceType trace_type = m_trace_type == ECollisionCompTraceType::SINGLE ? EAsyncTraceType::Single : EAsyncTraceType::Multi;
+
+	const int32 test_index = BeginAsyncCollisionTest();
+	FAsyncCollisionTest& test = m_async_tests[test_index];
+	GatherTraceSegments(test.m_segments);
 
-	FCollisionQueryParams params;
-	params.bTraceComplex = m_trace_complex;
-	params.bReturnFaceIndex = m_return_face_index;
-	params.bReturnPhysicalMaterial = m_return_physical_material;
-	params.bIgnoreBlocks = m_ignore_blocks;
-	params.bIgnoreTouches = m_ignore_touches;
-	params.bSkipNarrowPhase = m_skip_narrow_phase;
+	for (int32 segment_index = 0; segment_index < test.m_segments.Num(); ++segment_index)
+	{
+		const FCollisionTraceSegment& segment = test.m_segments[segment_index];
+		if (!PassesBroadPhase(segment)) continue;
+
+		// Analytic results are ready right away, nothing to wait for
+		const int32 first_hit = test.m_forward_hits.Num();
+		if (ExecuteAnalyticSegment(segment, test.m_forward_hits, test.m_reverse_hits))
+		{
+			DrawDebugTrace(world, segment, MakeArrayView(test.m_forward_hits).Slice(first_hit, test.m_forward_hits.Num() - first_hit));
+			continue;
+		}
 
-	params.AddIgnoredActor(GetOwner());
+		FCollisionLineData& line_data = m_collision_line_data[segment.m_data_index];
 
-	const USkeletalMeshComponent* parent_skeletal_mesh = Cast<USkeletalMeshComponent>(GetAttachParent());
+		INC_DWORD_STAT(STAT_ForwardTraces);
+		line_data.m_forward_trace_handle = DoAsyncLine(world, trace_type, segment.m_start, segment.m_end, params);
+		TrackAsyncTrace(line_data.m_forward_trace_handle, test_index, segment_index, false);
 
-	for (FCollisionLineData& line_data : m_collision_line_data)
+		if (ShouldTraceReverse())
+		{
+			INC_DWORD_STAT(STAT_ReverseTraces);
+			line_data.m_reverse_trace_handle = DoAsyncLine(world, EAsyncTraceType::Multi, segment.m_end, segment.m_start, params, true);
+			TrackAsyncTrace(line_data.m_reverse_trace_handle, test_index, segment_index, true);
+		}
+	}
+
+	// Nothing to wait for if none of the traces were started, though tests started before still have to finish first
+	CompleteAsyncCollisionTests();
+
+	return true;
+}
+
+bool UTraceAndSweepCollisionComponent::DoAsynchronousSweepCollisionTest()
+{
+	SCOPE_CYCLE_COUNTER(STAT_DoAsynchronousSweepCollisionTest);
+
+	UWorld* world = GetWorld();
+	if (!world) return false;
+
+	const FCollisionQueryParams& params = GetQueryParams();
+	EAsyncTraceType trace_type = m_trace_type == ECollisionCompTraceType::SINGLE ? EAsyncTraceType::Single : EAsyncTraceType::Multi;
+
+	const int32 test_index = BeginAsyncCollisionTest();
+	FAsyncCollisionTest& test = m_async_tests[test_index];
+	GatherTraceSegments(test.m_segments);
+
+	for (int32 segment_index = 0; segment_index < test.m_segments.Num(); ++segment_index)
 	{
-		bool valid_line_data = false;
-		FVector start = line_data.m_prev_location;
-		FVector end = start;
+		const FCollisionTraceSegment& segment = test.m_segments[segment_index];
+		if (!PassesBroadPhase(segment)) continue;
+
+		// Analytic results are ready right away, nothing to wait for
+		const int32 first_hit = test.m_forward_hits.Num();
+		if (ExecuteAnalyticSegment(segment, test.m_forward_hits, test.m_reverse_hits))
+		{
+			DrawDebugTrace(world, segment, MakeArrayView(test.m_forward_hits).Slice(first_hit, test.m_forward_hits.Num() - first_hit));
+			continue;
+		}
+
+		FCollisionShapeData& shape_data = m_collision_shape_data[segment.m_data_index];
 
-		if (line_data.m_scene_component_to_follow->IsValidLowLevel())
+		// Overlap at start goes through the manager's queue like the sweeps, its hits are merged into the test when it comes back
+		if (ShouldQueryStartOverlaps())
 		{
-			end = line_data.m_scene_component_to_follow->GetComponentLocation();
-			valid_line_data = true;
+			INC_DWORD_STAT(STAT_StartOverlapQueries);
+			const FTraceHandle overlap_handle = DoAsyncOverlap(world, segment.m_start, segment.m_start_rotation, shape_data, params);
+			TrackAsyncTrace(overlap_handle, test_index, segment_index, false, true);
 		}
-		else if (parent_skeletal_mesh && line_data.m_socket_name != NAME_None && parent_skeletal_mesh->DoesSocketExist(line_data.m_socket_name))
+
+		INC_DWORD_STAT(STAT_ForwardTraces);
+		shape_data.m_forward_trace_handle = DoAsyncSweep(world, trace_type, segment.m_start, segment.m_end, segment.m_end_rotation, shape_data, params);
+		TrackAsyncTrace(shape_data.m_forward_trace_handle, test_index, segment_index, false);
+
+		if (ShouldTraceReverse())
 		{
-			end = parent_skeletal_mesh->GetSocketLocation(line_data.m_socket_name);
-			valid_line_data = true;
+			INC_DWORD_STAT(STAT_ReverseTraces);
+			shape_data.m_reverse_trace_handle = DoAsyncSweep(world, EAsyncTraceType::Multi, segment.m_end, segment.m_start, segment.m_start_rotation, shape_data, params, true);
+			TrackAsyncTrace(shape_data.m_reverse_trace_handle, test_index, segment_index, true);
 		}
+	}
+
+	// Nothing to wait for if none of the traces were started, though tests started before still have to finish first
+	CompleteAsyncCollisionTests();
+
+	return true;
+}
+
+void UTraceAndSweepCollisionComponent::TrackAsyncTrace(const FTraceHandle& handle, int32 test_index, int32 segment_index, bool is_reverse, bool is_start_overlap /* = false*/)
+{
+	if (!handle.IsValid()) return;
+
+	m_async_trace_slots.Add(handle._Handle, FAsyncTraceSlot{ test_index, segment_index, is_reverse, is_start_overlap });
+	m_async_tests[test_index].m_num_pending_traces++;
+	m_num_pending_async_traces++;
+
+	if (m_telemetry)
+	{
+		GetTelemetryCounters()->m_num_traces++;
+		m_telemetry->AddAsyncInFlight(1);
+	}
+}
+
+void UTraceAndSweepCollisionComponent::ClearTraceHandle(uint64 handle, int32 data_index, bool is_reverse)
+{
+	// Line or shape could have been removed while trace was in flight, and a later test could have started a newer trace of it
+	FTraceHandle* trace_handle = nullptr;
+	if (m_style_type == ECollisionCompStyleType::LINE && m_collision_line_data.IsValidIndex(data_index))
+	{
+		trace_handle = is_reverse ? &m_collision_line_data[data_index].m_reverse_trace_handle : &m_collision_line_data[data_index].m_forward_trace_handle;
+	}
+	else if (m_style_type == ECollisionCompStyleType::SWEEP && m_collision_shape_data.IsValidIndex(data_index))
+	{
+		trace_handle = is_reverse ? &m_collision_shape_data[data_index].m_reverse_trace_handle : &m_collision_shape_data[data_index].m_forward_trace_handle;
+	}
+
+	if (trace_handle && trace_handle->_Handle == handle)
+	{
+		*trace_handle = FTraceHandle();
+	}
+}
+
+int32 UTraceAndSweepCollisionComponent::BeginAsyncCollisionTest()
+{
+	// Ring only grows once, tests in flight keep their index until they finish
+	if (m_async_tests.Num() == 0)
+	{
+		m_async_tests.SetNum(FMath::Max(1, m_max_async_tests_in_flight));
+	}
+
+	const int32 test_index = (m_first_async_test + m_num_async_tests) % m_async_tests.Num();
+	m_num_async_tests++;
+
+	// Buffers of a reused test keep their memory
+	FAsyncCollisionTest& test = m_async_tests[test_index];
+	test.m_frame = GFrameCounter;
+	test.m_start_cycles = FPlatformTime::Cycles64();
+	test.m_num_pending_traces = 0;
+	test.m_segments.Reset();
+	test.m_forward_hits.Reset();
+	test.m_reverse_hits.Reset();
 
-		if (valid_line_data)
+	m_is_previous_trace_complete = false;
+
+	return test_index;
+}
+
+void UTraceAndSweepCollisionComponent::CompleteAsyncCollisionTests()
+{
+	while (m_num_async_tests > 0 && m_async_tests[m_first_async_test].m_num_pending_traces == 0)
+	{
+		const FAsyncCollisionTest& test = m_async_tests[m_first_async_test];
+
+		ResetCollisionTestResults();
+		for (const FHitResult& forward_hit : test.m_forward_hits)
 		{
-			// check for forward hits, these results will be used for begin overlap check
-			TArray<FHitResult> forward_hits;
-			DoLineMulti(forward_hits, world, start, end, params);
-			for (FHitResult& forward_hit : forward_hits)
+			if (forward_hit.bBlockingHit)
 			{
-				if (forward_hit.bBlockingHit)
-				{
-					m_forward_hit_results.AddUnique(forward_hit);
-				}
+				AddForwardHit(forward_hit);
+			}
+		}
+		for (const FHitResult& reverse_hit : test.m_reverse_hits)
+		{
+			if (reverse_hit.bBlockingHit)
+			{
+				m_reverse_hit_results.AddUnique(reverse_hit);
 			}
+		}
+
+		// Removed before the events, which can reset the component
+		m_first_async_test = (m_first_async_test + 1) % m_async_tests.Num();
+		m_num_async_tests--;
+
+		FinishCollisionTest();
+	}
+
+	m_is_previous_trace_complete = m_num_async_tests < m_async_tests.Num();
+}
+
+void UTraceAndSweepCollisionComponent::EnforceAsyncResultLatency()
+{
+	if (m_max_async_result_latency <= 0) return;
+
+	UWorld* world = GetWorld();
+	if (!world) return;
+
+	// Only the oldest test can be late, the ones after it were started later
+	while (m_num_async_tests > 0 && GFrameCounter - m_async_tests[m_first_async_test].m_frame >= uint64(m_max_async_result_latency))
+	{
+		RetraceAsyncCollisionTest(world, m_first_async_test);
+		CompleteAsyncCollisionTests();
+	}
+}
+
+void UTraceAndSweepCollisionComponent::RetraceAsyncCollisionTest(UWorld* world, int32 test_index)
+{
+	SCOPE_CYCLE_COUNTER(STAT_RetraceAsyncCollisionTest);
+	INC_DWORD_STAT(STAT_RetracedAsyncCollisionTests);
+
+	FAsyncCollisionTest& test = m_async_tests[test_index];
+
+	// Forget the handles, so their results are dropped when they arrive
+	for (TMap<uint64, FAsyncTraceSlot>::TIterator it = m_async_trace_slots.CreateIterator(); it; ++it)
+	{
+		if (it->Value.m_test == test_index)
+		{
+			ClearTraceHandle(it->Key, test.m_segments[it->Value.m_segment].m_data_index, it->Value.m_is_reverse);
+			it.RemoveCurrent();
+		}
+	}
+
+	if (m_telemetry)
+	{
+		m_telemetry->AddAsyncInFlight(-test.m_num_pending_traces);
+	}
+	m_num_pending_async_traces -= test.m_num_pending_traces;
+	test.m_num_pending_traces = 0;
+
+	// Same segments the async traces were started with, traced against the world as it is now
+	test.m_forward_hits.Reset();
+	test.m_reverse_hits.Reset();
+
+	const FCollisionQueryParams& params = GetQueryParams();
+	int32 num_traces = 0;
+	for (const FCollisionTraceSegment& segment : test.m_segments)
+	{
+		// Shape could have been removed since
+		if (m_style_type == ECollisionCompStyleType::SWEEP && !m_collision_shape_data.IsValidIndex(segment.m_data_index)) continue;
+
+		const int32 first_hit = test.m_forward_hits.Num();
+		num_traces += ExecuteTraceSegment(world, segment, params, test.m_forward_hits, test.m_reverse_hits);
+		DrawDebugTrace(world, segment, MakeArrayView(test.m_forward_hits).Slice(first_hit, test.m_forward_hits.Num() - first_hit));
+	}
 
-			if (m_should_generate_end_overlap)
+	if (FCollisionTelemetryCounters* counters = GetTelemetryCounters())
+	{
+		counters->m_num_traces += num_traces;
+	}
+}
+
+void UTraceAndSweepCollisionComponent::AddStitchPoints()
+{
+	if (m_trace_pool || m_num_stitched_ticks >= max_stitched_ticks) return;
+
+	m_num_stitched_ticks++;
+
+	if (m_style_type == ECollisionCompStyleType::LINE)
+	{
+		RefreshSocketIndices();
+		const FLinePointSource source = MakeLinePointSource();
+
+		for (int32 index = 0; index < m_collision_line_data.Num(); ++index)
+		{
+			FVector location = FVector::ZeroVector;
+			if (GetLinePointLocation(m_collision_line_data[index], source, location))
 			{
-				// check for reverse hits, these results will be used for end overlap check
-				TArray<FHitResult> reverse_hits;
-				DoLineMulti(reverse_hits, world, end, start, params, true);
-				for (FHitResult& reverse_hit : reverse_hits)
-				{
-					if (reverse_hit.bBlockingHit)
-					{
-						m_reverse_hit_results.AddUnique(reverse_hit);
-					}
-				}
+				m_stitch_points.Add({ index, location, FQuat::Identity });
 			}
+		}
+	}
+	else if (m_style_type == ECollisionCompStyleType::SWEEP)
+	{
+		const FTransform comp_transform = GetComponentTransform();
+		for (int32 index = 0; index < m_collision_shape_data.Num(); ++index)
+		{
+			const FTransform shape_transform = m_collision_shape_data[index].m_offset * comp_transform;
+			m_stitch_points.Add({ index, shape_transform.GetLocation(), shape_transform.GetRotation() });
+		}
+	}
+}
 
-			line_data.m_prev_location = end;
 
-#if !UE_BUILD_SHIPPING
-			// Draw debug trace line
-			TraceAndSweepDebugDraw::DrawLineTraces(world
-				, start
-				, end
-				, forward_hits
-				, m_debug_draw_trace_lines
-				, m_debug_line_color
-				, m_debug_line_duration
-				, m_draw_debug_hit_point
-				, m_debug_hit_normal_color
-				, m_debug_touch_normal_color
-				, m_debug_hit_marker_duration
-				, m_debug_line_thickness);
-#endif
+UTraceAndSweepCollisionComponent::FLinePointSource UTraceAndSweepCollisionComponent::MakeLinePointSource() const
+{
+	FLinePointSource source;
+	source.m_skeletal_mesh = Cast<USkeletalMeshComponent>(GetAttachParent());
+
+	if (source.m_skeletal_mesh)
+	{
+		// Follower meshes don't have their own bone transforms, and indices are only valid for the asset they were resolved against
+		const bool is_cache_valid = !m_are_socket_indices_dirty && m_socket_indices_asset == TObjectKey<USkinnedAsset>(source.m_skeletal_mesh->GetSkinnedAsset());
+		if (is_cache_valid && !source.m_skeletal_mesh->LeaderPoseComponent.IsValid())
+		{
+			source.m_component_space_transforms = source.m_skeletal_mesh->GetComponentSpaceTransforms();
+			source.m_component_transform = source.m_skeletal_mesh->GetComponentTransform();
 		}
 	}
 
-	// All hit results are ready to be processed
-	ProcessForwardHitResults();
+	return source;
+}
 
-	if (m_should_generate_end_overlap)
+bool UTraceAndSweepCollisionComponent::GetLinePointLocation(const FCollisionLineData& line_data, const FLinePointSource& source, FVector& out_location) const
+{
+	FTransform transform;
+	if (GetLinePointTransform(line_data, source, transform))
 	{
-		ProcessReverseHitResults();
+		out_location = transform.GetLocation();
+		return true;
 	}
 
-	m_is_previous_trace_complete = true;
+	return false;
+}
+
+bool UTraceAndSweepCollisionComponent::GetLinePointTransform(const FCollisionLineData& line_data, const FLinePointSource& source, FTransform& out_transform) const
+{
+	if (line_data.m_scene_component_to_follow->IsValidLowLevel())
+	{
+		out_transform = line_data.m_scene_component_to_follow->GetComponentTransform();
+		return true;
+	}
+	else if (source.m_component_space_transforms.IsValidIndex(line_data.m_bone_index))
+	{
+		// Same as GetSocketTransform, without finding the socket by name
+		out_transform = line_data.m_socket_local_transform * source.m_component_space_transforms[line_data.m_bone_index] * source.m_component_transform;
+		return true;
+	}
+	else if (source.m_skeletal_mesh && line_data.m_socket_name != NAME_None && source.m_skeletal_mesh->DoesSocketExist(line_data.m_socket_name))
+	{
+		out_transform = source.m_skeletal_mesh->GetSocketTransform(line_data.m_socket_name);
+		return true;
+	}
+
+	return false;
+}
+
+FCollisionSubStepSettings UTraceAndSweepCollisionComponent::MakeSubStepSettings() const
+{
+	FCollisionSubStepSettings settings;
+	settings.m_max_angle = m_max_sub_step_angle;
+	settings.m_max_distance = m_max_sub_step_distance;
+	settings.m_max_sub_steps = m_max_sub_steps;
+	return settings;
+}
+
+void UTraceAndSweepCollisionComponent::RefreshSocketIndices()
+{
+	const USkeletalMeshComponent* parent_skeletal_mesh = Cast<USkeletalMeshComponent>(GetAttachParent());
+	const USkinnedAsset* skinned_asset = parent_skeletal_mesh ? parent_skeletal_mesh->GetSkinnedAsset() : nullptr;
+
+	if (!m_are_socket_indices_dirty && m_socket_indices_asset == TObjectKey<USkinnedAsset>(skinned_asset)) return;
+
+	m_are_socket_indices_dirty = false;
+	m_socket_indices_asset = TObjectKey<USkinnedAsset>(skinned_asset);
+
+	for (FCollisionLineData& line_data : m_collision_line_data)
+	{
+		line_data.m_bone_index = INDEX_NONE;
+		line_data.m_socket_local_transform = FTransform::Identity;
+
+		if (!skinned_asset || line_data.m_socket_name == NAME_None) continue;
+
+		int32 socket_index = INDEX_NONE;
+		if (!skinned_asset->FindSocketInfo(line_data.m_socket_name, line_data.m_socket_local_transform, line_data.m_bone_index, socket_index))
+		{
+			// Not a socket, could be a bone
+			line_data.m_socket_local_transform = FTransform::Identity;
+			line_data.m_bone_index = parent_skeletal_mesh->GetBoneIndex(line_data.m_socket_name);
+		}
+	}
+}
+
+bool UTraceAndSweepCollisionComponent::ExecuteAnalyticSegment(const FCollisionTraceSegment& segment, TArray<FHitResult>& out_forward_hits, TArray<FHitResult>& out_reverse_hits) const
+{
+	if (!m_use_analytic_narrow_phase || !m_use_broad_phase || !m_broad_phase) return false;
+
+	TraceAndSweepNarrowPhase::FSweptShape shape;
+	if (m_style_type == ECollisionCompStyleType::SWEEP)
+	{
+		const FCollisionShapeData& shape_data = m_collision_shape_data[segment.m_data_index];
+		shape.m_shape_type = shape_data.m_shape_type;
+		shape.m_extent = GetShapeExtent(shape_data);
+	}
+
+	FCollisionCandidateArray candidates;
+	m_broad_phase->GatherCandidates(segment.m_start, segment.m_end, segment.m_radius, candidates);
+
+	const AActor* owner = GetOwner();
+	for (int32 index = candidates.Num() - 1; index >= 0; --index)
+	{
+		const UPrimitiveComponent* target = m_broad_phase->GetTarget(candidates[index]).Get();
+		if (!target || target->GetOwner() == owner || m_ignored_actors.Contains(target->GetOwner()) || m_ignored_components.Contains(target))
+		{
+			// Same as ignored actors and components in query params
+			candidates.RemoveAtSwap(index, 1, EAllowShrinking::No);
+		}
+		else if (!TraceAndSweepNarrowPhase::IsPairSupported(shape, m_broad_phase->GetTargetShape(candidates[index])))
+		{
+			return false;
+		}
+	}
+
+	INC_DWORD_STAT(STAT_AnalyticNarrowPhaseSegments);
+
+	// Forward sweep
+	shape.m_rotation = segment.m_end_rotation;
+	SweepAnalyticCandidates(*m_broad_phase, candidates, shape, segment.m_start, segment.m_end, m_trace_type == ECollisionCompTraceType::SINGLE, out_forward_hits);
+
+	// Reverse sweep
+	if (ShouldTraceReverse())
+	{
+		shape.m_rotation = segment.m_start_rotation;
+		SweepAnalyticCandidates(*m_broad_phase, candidates, shape, segment.m_end, segment.m_start, false, out_reverse_hits);
+	}
 
 	return true;
 }
 
-bool UTraceAndSweepCollisionComponent::DoSynchronousSweepMultiCollisionTest()
+bool UTraceAndSweepCollisionComponent::PassesBroadPhase(const FCollisionTraceSegment& segment) const
 {
-	SCOPE_CYCLE_COUNTER(STAT_DoSynchronousSweepMultiCollisionTest);
+	if (!m_use_broad_phase || !m_broad_phase) return true;
 
-	UWorld* world = GetWorld();
-	if (!world) return false;
+	if (m_broad_phase->OverlapsAnyTarget(segment.m_start, segment.m_end, segment.m_radius))
+	{
+		return true;
+	}
 
-	m_is_previous_trace_complete = false;
+	INC_DWORD_STAT(STAT_BroadPhaseCulledSegments);
+	return false;
+}
+
+void UTraceAndSweepCollisionComponent::RefreshPoolSlots()
+{
+	if (!m_trace_pool) return;
 
-	FCollisionQueryParams params;
-	params.bTraceComplex = m_trace_complex;
-	params.bReturnFaceIndex = m_return_face_index;
-	params.bReturnPhysicalMaterial = m_return_physical_material;
-	params.bIgnoreBlocks = m_ignore_blocks;
-	params.bIgnoreTouches = m_ignore_touches;
-	params.bSkipNarrowPhase = m_skip_narrow_phase;
+	const int32 num_data = m_style_type == ECollisionCompStyleType::LINE ? m_collision_line_data.Num() : m_collision_shape_data.Num();
 
-	params.AddIgnoredActor(GetOwner());
+	while (m_pool_slots.Num() > num_data)
+	{
+		m_trace_pool->FreeSlot(m_pool_slots.Pop(EAllowShrinking::No));
+	}
 
-	FTransform current_comp_transform = GetComponentTransform();
+	// New slots start from previous location saved in the data, so that first trace starts from correct location
+	while (m_pool_slots.Num() < num_data)
+	{
+		const int32 data_index = m_pool_slots.Num();
+		const int32 slot = m_trace_pool->AllocateSlot(m_pool_owner, data_index);
+		m_pool_slots.Add(slot);
 
-	for (FCollisionShapeData& shape_data : m_collision_shape_data)
+		if (m_style_type == ECollisionCompStyleType::LINE)
+		{
+			m_trace_pool->SetPrevious(slot, m_collision_line_data[data_index].m_prev_location, FQuat::Identity);
+		}
+		else
+		{
+			m_trace_pool->SetPrevious(slot, m_collision_shape_data[data_index].m_prev_location, m_collision_shape_data[data_index].m_prev_rotation);
+		}
+	}
+
+	if (m_style_type == ECollisionCompStyleType::SWEEP)
 	{
-		FVector start = shape_data.m_prev_location;
-		FTransform end_transform = shape_data.m_offset * current_comp_transform;
-		FVector end_location = end_transform.GetLocation();
-		FQuat end_rotation = end_transform.GetRotation();
+		const FCollisionSubStepSettings sub_step_settings = MakeSubStepSettings();
+		for (int32 index = 0; index < m_collision_shape_data.Num(); ++index)
+		{
+			m_trace_pool->SetExtent(m_pool_slots[index], GetShapeExtent(m_collision_shape_data[index]));
+			m_trace_pool->SetSubStepSettings(m_pool_slots[index], sub_step_settings);
+		}
+	}
+}
 
-		// Forward sweep
-		TArray<FHitResult> forward_hits;
-		DoSweepMulti(forward_hits, world, start, end_location, end_rotation, shape_data, params);
-		for (FHitResult& forward_hit : forward_hits)
+void UTraceAndSweepCollisionComponent::ReleasePoolSlots()
+{
+	if (m_trace_pool)
+	{
+		for (const int32 slot : m_pool_slots)
 		{
-			if (forward_hit.bBlockingHit)
-			{
-				m_forward_hit_results.AddUnique(forward_hit);
-			}
+			m_trace_pool->FreeSlot(slot);
 		}
+	}
 
-		// Reverse Sweep
-		if (m_should_generate_end_overlap)
+	m_pool_slots.Reset();
+	m_trace_pool = nullptr;
+	m_pool_owner = INDEX_NONE;
+}
+
+void UTraceAndSweepCollisionComponent::WritePoolTransforms()
+{
+	check(m_trace_pool);
+
+	if (m_style_type == ECollisionCompStyleType::LINE)
+	{
+		RefreshSocketIndices();
+		const FLinePointSource source = MakeLinePointSource();
+
+		for (int32 index = 0; index < m_pool_slots.Num(); ++index)
 		{
-			// check for reverse hits, these results will be used for end overlap check
-			TArray<FHitResult> reverse_hits;
-			DoSweepMulti(reverse_hits, world, end_location, start, shape_data.m_prev_rotation, shape_data, params, true);
-			for (FHitResult& reverse_hit : reverse_hits)
+			FVector location;
+			if (GetLinePointLocation(m_collision_line_data[index], source, location))
 			{
-				if (reverse_hit.bBlockingHit)
-				{
-					m_reverse_hit_results.AddUnique(reverse_hit);
-				}
+				m_trace_pool->SetCurrent(m_pool_slots[index], location, FQuat::Identity);
 			}
 		}
+	}
+	else if (m_style_type == ECollisionCompStyleType::SWEEP)
+	{
+		const FTransform current_comp_transform = GetComponentTransform();
 
-		shape_data.m_prev_location = end_location;
-		shape_data.m_prev_rotation = end_rotation;
+		for (int32 index = 0; index < m_pool_slots.Num(); ++index)
+		{
+			const FTransform shape_transform = m_collision_shape_data[index].m_offset * current_comp_transform;
+			m_trace_pool->SetCurrent(m_pool_slots[index], shape_transform.GetLocation(), shape_transform.GetRotation());
+		}
+	}
+}
+
+void UTraceAndSweepCollisionComponent::DrawDebugTrace(UWorld* world, const FCollisionTraceSegment& segment, TConstArrayView<FHitResult> hits) const
+{
+#if !UE_BUILD_SHIPPING
+	if (m_style_type == ECollisionCompStyleType::LINE)
+	{
+		// Draw debug trace line
+		TraceAndSweepDebugDraw::DrawLineTraces(world
+			, segment.m_start
+			, segment.m_end
+			, hits
+			, m_debug_draw_trace_lines
+			, m_debug_line_color
+			, m_debug_line_duration
+			, m_draw_debug_hit_point
+			, m_debug_hit_normal_color
+			, m_debug_touch_normal_color
+			, m_debug_hit_marker_duration
+			, m_debug_line_thickness);
+	}
+	else if (m_style_type == ECollisionCompStyleType::SWEEP)
+	{
+		const FCollisionShapeData& shape_data = m_collision_shape_data[segment.m_data_index];
 
-#if !UE_BUILD_SHIPPING
 		if (shape_data.m_shape_type == ECollisionCompShapeType::BOX)
 		{
 			TraceAndSweepDebugDraw::DrawBoxSweep(world
-				, start
-				, end_location
+				, segment.m_start
+				, segment.m_end
 				, shape_data.m_box_half_extent
-				, end_rotation
-				, forward_hits
+				, segment.m_end_rotation
+				, hits
 				, m_debug_draw_sweep_shape
 				, m_debug_sweep_shape_color
 				, m_debug_sweep_shape_duration
@@ -523,12 +1407,12 @@ bool UTraceAndSweepCollisionComponent::DoSynchronousSweepMultiCollisionTest()
 		else if (shape_data.m_shape_type == ECollisionCompShapeType::CAPSULE)
 		{
 			TraceAndSweepDebugDraw::DrawCapsuleSweep(world
-				, start
-				, end_location
+				, segment.m_start
+				, segment.m_end
 				, shape_data.m_capsule_half_height
 				, shape_data.m_capsule_radius
-				, end_rotation
-				, forward_hits
+				, segment.m_end_rotation
+				, hits
 				, m_debug_draw_sweep_shape
 				, m_debug_sweep_shape_color
 				, m_debug_sweep_shape_duration
@@ -541,10 +1425,10 @@ bool UTraceAndSweepCollisionComponent::DoSynchronousSweepMultiCollisionTest()
 		else if (shape_data.m_shape_type == ECollisionCompShapeType::SPHERE)
 		{
 			TraceAndSweepDebugDraw::DrawSphereSweep(world
-				, start
-				, end_location
+				, segment.m_start
+				, segment.m_end
 				, shape_data.m_sphere_radius
-				, forward_hits
+				, hits
 				, m_debug_draw_sweep_shape
 				, m_debug_sweep_shape_color
 				, m_debug_sweep_shape_duration
@@ -554,113 +1438,8 @@ bool UTraceAndSweepCollisionComponent::DoSynchronousSweepMultiCollisionTest()
 				, m_debug_hit_marker_duration
 				, m_debug_line_thickness);
 		}
-#endif
-	}
-
-	// All hit results are ready to be processed
-	ProcessForwardHitResults();
-
-	if (m_should_generate_end_overlap)
-	{
-		ProcessReverseHitResults();
-	}
-
-	m_is_previous_trace_complete = true;
-
-	return true;
-}
-#pragma endregion
-
-bool UTraceAndSweepCollisionComponent::DoAsynchronousLineCollisionTest()
-{
-	SCOPE_CYCLE_COUNTER(STAT_DoAsynchronousLineCollisionTest);
-
-	UWorld* world = GetWorld();
-	if (!world) return false;
-
-	m_is_previous_trace_complete = false;
-
-	FCollisionQueryParams params;
-	params.bTraceComplex = m_trace_complex;
-	params.bReturnFaceIndex = m_return_face_index;
-	params.bReturnPhysicalMaterial = m_return_physical_material;
-	params.bIgnoreBlocks = m_ignore_blocks;
-	params.bIgnoreTouches = m_ignore_touches;
-	params.bSkipNarrowPhase = m_skip_narrow_phase;
-
-	params.AddIgnoredActor(GetOwner());
-
-	const USkeletalMeshComponent* parent_skeletal_mesh = Cast<USkeletalMeshComponent>(GetAttachParent());
-	EAsyncTraceType trace_type = m_trace_type == ECollisionCompTraceType::SINGLE ? EAsyncTraceType::Single : EAsyncTraceType::Multi;
-
-	for (FCollisionLineData& line_data : m_collision_line_data)
-	{
-		bool valid_line_data = false;
-		FVector start = line_data.m_prev_location;
-		FVector end = start;
-
-		if (line_data.m_scene_component_to_follow->IsValidLowLevel())
-		{
-			end = line_data.m_scene_component_to_follow->GetComponentLocation();
-			valid_line_data = true;
-		}
-		else if (parent_skeletal_mesh && line_data.m_socket_name != NAME_None && parent_skeletal_mesh->DoesSocketExist(line_data.m_socket_name))
-		{
-			end = parent_skeletal_mesh->GetSocketLocation(line_data.m_socket_name);
-			valid_line_data = true;
-		}
-
-		if (valid_line_data)
-		{
-			m_is_previous_trace_complete = false;
-
-			line_data.m_forward_trace_handle = DoAsyncLine(world, trace_type, start, end, params);
-			line_data.m_reverse_trace_handle = DoAsyncLine(world, EAsyncTraceType::Multi, end, start, params, true);
-
-			line_data.m_prev_location = end;
-		}
-	}
-
-	return true;
-}
-
-bool UTraceAndSweepCollisionComponent::DoAsynchronousSweepCollisionTest()
-{
-	SCOPE_CYCLE_COUNTER(STAT_DoAsynchronousSweepCollisionTest);
-
-	UWorld* world = GetWorld();
-	if (!world) return false;
-
-	m_is_previous_trace_complete = false;
-
-	FCollisionQueryParams params;
-	params.bTraceComplex = m_trace_complex;
-	params.bReturnFaceIndex = m_return_face_index;
-	params.bReturnPhysicalMaterial = m_return_physical_material;
-	params.bIgnoreBlocks = m_ignore_blocks;
-	params.bIgnoreTouches = m_ignore_touches;
-	params.bSkipNarrowPhase = m_skip_narrow_phase;
-
-	params.AddIgnoredActor(GetOwner());
-
-	FTransform current_comp_transform = GetComponentTransform();
-	EAsyncTraceType trace_type = m_trace_type == ECollisionCompTraceType::SINGLE ? EAsyncTraceType::Single : EAsyncTraceType::Multi;
-
-	for (FCollisionShapeData& shape_data : m_collision_shape_data)
-	{
-		FVector start = shape_data.m_prev_location;
-		FTransform end_transform = shape_data.m_offset * current_comp_transform;
-		FVector end_location = end_transform.GetLocation();
-		FQuat end_rotation = end_transform.GetRotation();
-
-		shape_data.m_forward_trace_handle = DoAsyncSweep(world, trace_type, start, end_location, end_rotation, shape_data, params);
-		shape_data.m_reverse_trace_handle = DoAsyncSweep(world, EAsyncTraceType::Multi, end_location, start, shape_data.m_prev_rotation, shape_data, params, true);
-
-		shape_data.m_prev_location = end_location;
-		shape_data.m_prev_rotation = end_rotation;
 	}
-
-	return true;
+#endif
 }
 
 
@@ -675,8 +1454,7 @@ bool UTraceAndSweepCollisionComponent::DoLineSingle(FHitResult& out_result, UWor
 	}
 	else if (m_channel_type == ECollisionCompChannelType::OBJECT_CHANNEL)
 	{
-		FCollisionObjectQueryParams object_params(m_object_channels);
-		world->LineTraceSingleByObjectType(out_result, start, end, object_params, params);
+		world->LineTraceSingleByObjectType(out_result, start, end, m_object_query_params, params);
 		return true;
 	}
 	else if (m_channel_type == ECollisionCompChannelType::COLLISION_PRESET)
@@ -703,8 +1481,7 @@ bool UTraceAndSweepCollisionComponent::DoLineMulti(TArray<FHitResult>& out_resul
 		}
 		else if (m_channel_type == ECollisionCompChannelType::OBJECT_CHANNEL)
 		{
-			FCollisionObjectQueryParams object_params(m_object_channels);
-			world->LineTraceMultiByObjectType(out_results, start, end, object_params, params);
+			world->LineTraceMultiByObjectType(out_results, start, end, m_object_query_params, params);
 			return true;
 		}
 		else if (m_channel_type == ECollisionCompChannelType::COLLISION_PRESET)
@@ -748,8 +1525,7 @@ bool UTraceAndSweepCollisionComponent::DoSweepSingle(FHitResult& out_result, UWo
 	}
 	else if (m_channel_type == ECollisionCompChannelType::OBJECT_CHANNEL)
 	{
-		FCollisionObjectQueryParams object_params(m_object_channels);
-		world->SweepSingleByObjectType(out_result, start, end, rotation, object_params, shape, params);
+		world->SweepSingleByObjectType(out_result, start, end, rotation, m_object_query_params, shape, params);
 		return true;
 	}
 	else if (m_channel_type == ECollisionCompChannelType::COLLISION_PRESET)
@@ -791,8 +1567,7 @@ bool UTraceAndSweepCollisionComponent::DoSweepMulti(TArray<FHitResult>& out_resu
 		}
 		else if (m_channel_type == ECollisionCompChannelType::OBJECT_CHANNEL)
 		{
-			FCollisionObjectQueryParams object_params(m_object_channels);
-			world->SweepMultiByObjectType(out_results, start, end, rotation, object_params, shape, params);
+			world->SweepMultiByObjectType(out_results, start, end, rotation, m_object_query_params, shape, params);
 			return true;
 		}
 		else if (m_channel_type == ECollisionCompChannelType::COLLISION_PRESET)
@@ -810,6 +1585,81 @@ bool UTraceAndSweepCollisionComponent::DoSweepMulti(TArray<FHitResult>& out_resu
 	return false;
 }
 
+bool UTraceAndSweepCollisionComponent::DoOverlapMulti(TArray<FOverlapResult>& out_results, UWorld* world, const FVector& location, const FQuat rotation, const FCollisionShapeData& shape_data, const FCollisionQueryParams& params) const
+{
+	check(world != nullptr);
+
+	const FCollisionShape shape = MakeCollisionShape(shape_data);
+
+	if (m_channel_type == ECollisionCompChannelType::TRACE_CHANNEL)
+	{
+		world->OverlapMultiByChannel(out_results, location, rotation, m_trace_channel, shape, params);
+		return true;
+	}
+	else if (m_channel_type == ECollisionCompChannelType::OBJECT_CHANNEL)
+	{
+		world->OverlapMultiByObjectType(out_results, location, rotation, m_object_query_params, shape, params);
+		return true;
+	}
+	else if (m_channel_type == ECollisionCompChannelType::COLLISION_PRESET)
+	{
+		world->OverlapMultiByProfile(out_results, location, rotation, m_collision_preset.Name, shape, params);
+		return true;
+	}
+
+	return false;
+}
+
+void UTraceAndSweepCollisionComponent::AddStartOverlaps(UWorld* world, const FCollisionTraceSegment& segment, const FCollisionShapeData& shape_data, const FCollisionQueryParams& params, TArray<FHitResult>& out_forward_hits) const
+{
+	INC_DWORD_STAT(STAT_StartOverlapQueries);
+
+	// One per thread since batched segments are executed on worker threads, keeps its memory so steady state doesn't allocate
+	static thread_local TArray<FOverlapResult> overlaps;
+	overlaps.Reset();
+	DoOverlapMulti(overlaps, world, segment.m_start, segment.m_start_rotation, shape_data, params);
+
+	AppendStartOverlapHits(overlaps, segment.m_start, segment.m_end, out_forward_hits);
+}
+
+void UTraceAndSweepCollisionComponent::AppendStartOverlapHits(TConstArrayView<FOverlapResult> overlaps, const FVector& start, const FVector& end, TArray<FHitResult>& out_hits)
+{
+	// Same as the zero distance hit a sweep reports for an object it starts inside of, so it keeps the overlap but never begins one
+	for (const FOverlapResult& overlap : overlaps)
+	{
+		if (!overlap.bBlockingHit) continue;
+
+		FHitResult& hit = out_hits.Emplace_GetRef(overlap.GetActor(), overlap.GetComponent(), start, FVector::ZeroVector);
+		hit.bBlockingHit = true;
+		hit.bStartPenetrating = true;
+		hit.Time = 0.0f;
+		hit.Distance = 0.0f;
+		hit.Item = overlap.ItemIndex;
+		hit.TraceStart = start;
+		hit.TraceEnd = end;
+	}
+}
+
+FTraceHandle UTraceAndSweepCollisionComponent::DoAsyncOverlap(UWorld* world, const FVector& location, const FQuat rotation, const FCollisionShapeData& shape_data, const FCollisionQueryParams& params)
+{
+	const FCollisionShape shape = MakeCollisionShape(shape_data);
+
+	if (m_channel_type == ECollisionCompChannelType::TRACE_CHANNEL)
+	{
+		return world->AsyncOverlapByChannel(location, rotation, m_trace_channel, shape, params, FCollisionResponseParams::DefaultResponseParam, m_async_overlap_delegate, m_async_route);
+	}
+	else if (m_channel_type == ECollisionCompChannelType::OBJECT_CHANNEL)
+	{
+		return world->AsyncOverlapByObjectType(location, rotation, m_object_query_params, shape, params, m_async_overlap_delegate, m_async_route);
+	}
+	else if (m_channel_type == ECollisionCompChannelType::COLLISION_PRESET)
+	{
+		return world->AsyncOverlapByProfile(location, rotation, m_collision_preset.Name, shape, params, m_async_overlap_delegate, m_async_route);
+	}
+
+	return FTraceHandle();
+}
+
 FTraceHandle UTraceAndSweepCollisionComponent::DoAsyncLine(UWorld* world, const EAsyncTraceType trace_type, const FVector& start, const FVector& end, const FCollisionQueryParams& params, bool is_reverse /* = false*/)
 {
 	const bool is_special_case = is_reverse && trace_type == EAsyncTraceType::Multi && (m_channel_type == ECollisionCompChannelType::TRACE_CHANNEL || m_channel_type == ECollisionCompChannelType::COLLISION_PRESET);
@@ -818,21 +1668,20 @@ FTraceHandle UTraceAndSweepCollisionComponent::DoAsyncLine(UWorld* world, const
 	{
 		if (m_channel_type == ECollisionCompChannelType::TRACE_CHANNEL)
 		{
-			return world->AsyncLineTraceByChannel(trace_type, start, end, m_trace_channel, params, FCollisionResponseParams::DefaultResponseParam, &m_async_trace_delegate);
+			return world->AsyncLineTraceByChannel(trace_type, start, end, m_trace_channel, params, FCollisionResponseParams::DefaultResponseParam, m_async_trace_delegate, m_async_route);
 		}
 		else if (m_channel_type == ECollisionCompChannelType::OBJECT_CHANNEL)
 		{
-			FCollisionObjectQueryParams object_params(m_object_channels);
-			return world->AsyncLineTraceByObjectType(trace_type, start, end, object_params, params, &m_async_trace_delegate);
+			return world->AsyncLineTraceByObjectType(trace_type, start, end, m_object_query_params, params, m_async_trace_delegate, m_async_route);
 		}
 		else if (m_channel_type == ECollisionCompChannelType::COLLISION_PRESET)
 		{
-			return world->AsyncLineTraceByProfile(trace_type, start, end, m_collision_preset.Name, params, &m_async_trace_delegate);
+			return world->AsyncLineTraceByProfile(trace_type, start, end, m_collision_preset.Name, params, m_async_trace_delegate, m_async_route);
 		}
 	}
 	else
 	{
-		return world->AsyncLineTraceByObjectType(trace_type, start, end, FCollisionObjectQueryParams::AllObjects, params, &m_async_trace_delegate);
+		return world->AsyncLineTraceByObjectType(trace_type, start, end, FCollisionObjectQueryParams::AllObjects, params, m_async_trace_delegate, m_async_route);
 	}
 
 	return FTraceHandle();
@@ -861,327 +1710,516 @@ FTraceHandle UTraceAndSweepCollisionComponent::DoAsyncSweep(UWorld* world, const
 	{
 		if (m_channel_type == ECollisionCompChannelType::TRACE_CHANNEL)
 		{
-			return world->AsyncSweepByChannel(trace_type, start, end, rotation, m_trace_channel, shape, params, FCollisionResponseParams::DefaultResponseParam, &m_async_trace_delegate);
+			return world->AsyncSweepByChannel(trace_type, start, end, rotation, m_trace_channel, shape, params, FCollisionResponseParams::DefaultResponseParam, m_async_trace_delegate, m_async_route);
 		}
 		else if (m_channel_type == ECollisionCompChannelType::OBJECT_CHANNEL)
 		{
-			FCollisionObjectQueryParams object_params(m_object_channels);
-			return world->AsyncSweepByObjectType(trace_type, start, end, rotation, object_params, shape, params, &m_async_trace_delegate);
+			return world->AsyncSweepByObjectType(trace_type, start, end, rotation, m_object_query_params, shape, params, m_async_trace_delegate, m_async_route);
 		}
 		else if (m_channel_type == ECollisionCompChannelType::COLLISION_PRESET)
 		{
-			return world->AsyncSweepByProfile(trace_type, start, end, rotation, m_collision_preset.Name, shape, params, &m_async_trace_delegate);
+			return world->AsyncSweepByProfile(trace_type, start, end, rotation, m_collision_preset.Name, shape, params, m_async_trace_delegate, m_async_route);
 		}
 	}
 	else
 	{
-		return world->AsyncSweepByObjectType(trace_type, start, end, rotation, FCollisionObjectQueryParams::AllObjects, shape, params, &m_async_trace_delegate);
+		return world->AsyncSweepByObjectType(trace_type, start, end, rotation, FCollisionObjectQueryParams::AllObjects, shape, params, m_async_trace_delegate, m_async_route);
 	}
 
 	return FTraceHandle();
 }
 
-void UTraceAndSweepCollisionComponent::OnAsyncTraceComplete(const FTraceHandle& handle, FTraceDatum& data)
+void UTraceAndSweepCollisionComponent::ReceiveAsyncTraceResults(TConstArrayView<const FCollisionAsyncTraceRecord*> records)
 {
-	FCollisionLineData* line_data_ptr = nullptr;
-	FCollisionShapeData* shape_data_ptr = nullptr;
-
-	if (m_style_type == ECollisionCompStyleType::LINE)
+	for (const FCollisionAsyncTraceRecord* record : records)
 	{
-		line_data_ptr = m_collision_line_data.FindByPredicate(
-			[&](const FCollisionLineData& other)
-			{
-				return other.m_forward_trace_handle.IsValid() && other.m_forward_trace_handle == handle;
-			});
+		ReceiveAsyncTraceResult(record->m_handle, record->m_start, record->m_end, record->m_rotation, record->m_hits);
 	}
-	else if (m_style_type == ECollisionCompStyleType::SWEEP)
+}
+
+void UTraceAndSweepCollisionComponent::ReceiveAsyncTraceResult(uint64 handle, const FVector& start, const FVector& end, const FQuat& rotation, TConstArrayView<FHitResult> hits)
+{
+	FAsyncTraceSlot slot;
+	if (!m_async_trace_slots.RemoveAndCopyValue(handle, slot))
 	{
-		shape_data_ptr = m_collision_shape_data.FindByPredicate(
-			[&](const FCollisionShapeData& other)
-			{
-				return other.m_forward_trace_handle.IsValid() && other.m_forward_trace_handle == handle;
-			});
+		// Handle from a collision test that isn't being tracked anymore (Eg: it was late and traced again on game thread)
+		return;
 	}
 
-	if (line_data_ptr || shape_data_ptr)
+	FAsyncCollisionTest& test = m_async_tests[slot.m_test];
+	const int32 data_index = test.m_segments[slot.m_segment].m_data_index;
+
+	if (m_telemetry)
 	{
-		// Forward trace
-		// Clear the handle
-		if (line_data_ptr)
-			line_data_ptr->m_forward_trace_handle = FTraceHandle();
-		else if (shape_data_ptr)
-			shape_data_ptr->m_forward_trace_handle = FTraceHandle();
+		m_telemetry->AddAsyncInFlight(-1);
+		m_telemetry->AddAsyncLatency(FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - test.m_start_cycles));
+	}
+
+	ClearTraceHandle(handle, data_index, slot.m_is_reverse);
 
-		for (const FHitResult& forward_hit : data.OutHits)
+	// Hits wait in their test until every test before it has finished
+	if (slot.m_is_start_overlap)
+	{
+		// Manager only knows where the overlap was, the end of the sweep comes from the segment
+		const int32 first_hit = test.m_forward_hits.Num();
+		test.m_forward_hits.Append(hits.GetData(), hits.Num());
+		for (int32 index = first_hit; index < test.m_forward_hits.Num(); ++index)
 		{
-			if (forward_hit.bBlockingHit)
-			{
-				m_forward_hit_results.AddUnique(forward_hit);
-			}
+			test.m_forward_hits[index].TraceEnd = test.m_segments[slot.m_segment].m_end;
 		}
+	}
+	else if (!slot.m_is_reverse)
+	{
+		// Forward trace
+		test.m_forward_hits.Append(hits.GetData(), hits.Num());
 
 #if !UE_BUILD_SHIPPING
-		if (line_data_ptr)
-		{
-			// Draw debug trace line
-			TraceAndSweepDebugDraw::DrawLineTraces(GetWorld()
-				, data.Start
-				, data.End
-				, data.OutHits
-				, m_debug_draw_trace_lines
-				, m_debug_line_color
-				, m_debug_line_duration
-				, m_draw_debug_hit_point
-				, m_debug_hit_normal_color
-				, m_debug_touch_normal_color
-				, m_debug_hit_marker_duration
-				, m_debug_line_thickness);
+		if (m_style_type == ECollisionCompStyleType::LINE || m_collision_shape_data.IsValidIndex(data_index))
+		{
+			FCollisionTraceSegment segment;
+			segment.m_data_index = data_index;
+			segment.m_start = start;
+			segment.m_end = end;
+			segment.m_end_rotation = rotation;
+			DrawDebugTrace(GetWorld(), segment, hits);
 		}
-		else if (shape_data_ptr)
+#endif
+	}
+	else
+	{
+		// Reverse trace
+		test.m_reverse_hits.Append(hits.GetData(), hits.Num());
+	}
+
+	--m_num_pending_async_traces;
+	if (--test.m_num_pending_traces == 0)
+	{
+		CompleteAsyncCollisionTests();
+	}
+}
+
+
+void UTraceAndSweepCollisionComponent::AddForwardHit(const FHitResult& hit)
+{
+	bool is_new = false;
+	FCollisionHitEntry& entry = m_forward_hit_results.FindOrAdd(hit, is_new);
+
+	// Overlapped results only change in FinishCollisionTest, so a hit that is already overlapped now won't begin an overlap and only needs the record
+	if (is_new && hit.Distance != 0.0f && !m_overlapped_results.Find(entry.m_key))
+	{
+		entry.m_result_index = m_begin_overlap_results.Add(hit);
+	}
+}
+
+void UTraceAndSweepCollisionComponent::ProcessForwardHitResults()
+{
+	for (const FCollisionHitEntry& entry : m_forward_hit_results.GetEntries())
+	{
+		if (entry.m_record.m_distance != 0.0f)
 		{
-			if (shape_data_ptr->m_shape_type == ECollisionCompShapeType::BOX)
-			{
-				TraceAndSweepDebugDraw::DrawBoxSweep(GetWorld()
-					, data.Start
-					, data.End
-					, shape_data_ptr->m_box_half_extent
-					, data.Rot
-					, data.OutHits
-					, m_debug_draw_sweep_shape
-					, m_debug_sweep_shape_color
-					, m_debug_sweep_shape_duration
-					, m_draw_debug_hit_point
-					, m_debug_hit_normal_color
-					, m_debug_touch_normal_color
-					, m_debug_hit_marker_duration
-					, m_debug_line_thickness);
-			}
-			else if (shape_data_ptr->m_shape_type == ECollisionCompShapeType::CAPSULE)
+			bool is_new_overlap = false;
+			FCollisionHitEntry& overlap = m_overlapped_results.FindOrAdd(entry.m_key, entry.m_record, is_new_overlap);
+			overlap.m_count++;
+
+			if (is_new_overlap)
 			{
-				TraceAndSweepDebugDraw::DrawCapsuleSweep(GetWorld()
-					, data.Start
-					, data.End
-					, shape_data_ptr->m_capsule_half_height
-					, shape_data_ptr->m_capsule_radius
-					, data.Rot
-					, data.OutHits
-					, m_debug_draw_sweep_shape
-					, m_debug_sweep_shape_color
-					, m_debug_sweep_shape_duration
-					, m_draw_debug_hit_point
-					, m_debug_hit_normal_color
-					, m_debug_touch_normal_color
-					, m_debug_hit_marker_duration
-					, m_debug_line_thickness);
+				if (FCollisionTelemetryCounters* counters = GetTelemetryCounters())
+				{
+					counters->m_num_begin_overlaps++;
+				}
+
+				// Copied since event handlers can change this component
+				const FHitResult result = entry.m_result_index != INDEX_NONE ? m_begin_overlap_results[entry.m_result_index] : entry.m_record.MakeHitResult();
+
+				// broadcast begin overlapevent
+				if (OnComponentBeginOverlap.IsBound())
+				{
+					OnComponentBeginOverlap.Broadcast(this, result.GetActor(), result.GetComponent(), result.Item, true, result);
+				}
+				if (result.GetComponent() && result.GetComponent()->GetGenerateOverlapEvents())
+				{
+					result.GetComponent()->OnComponentBeginOverlap.Broadcast(result.GetComponent(), Cast<AActor>(this->GetOwner()), this, -1, true, result);
+				}
 			}
-			else if (shape_data_ptr->m_shape_type == ECollisionCompShapeType::SPHERE)
+		}
+	}
+
+	if (!m_should_generate_end_overlap)
+	{
+		m_overlapped_results.Reset();
+	}
+}
+
+void UTraceAndSweepCollisionComponent::ProcessReverseHitResults()
+{
+	for (const FCollisionHitEntry& entry : m_reverse_hit_results.GetEntries())
+	{
+		if (entry.m_record.m_distance != 0.0f)
+		{
+			if (m_overlapped_results.Release(entry.m_key))
 			{
-				TraceAndSweepDebugDraw::DrawSphereSweep(GetWorld()
-					, data.Start
-					, data.End
-					, shape_data_ptr->m_sphere_radius
-					, data.OutHits
-					, m_debug_draw_sweep_shape
-					, m_debug_sweep_shape_color
-					, m_debug_sweep_shape_duration
-					, m_draw_debug_hit_point
-					, m_debug_hit_normal_color
-					, m_debug_touch_normal_color
-					, m_debug_hit_marker_duration
-					, m_debug_line_thickness);
+				if (FCollisionTelemetryCounters* counters = GetTelemetryCounters())
+				{
+					counters->m_num_end_overlaps++;
+				}
+
+				UPrimitiveComponent* other_component = entry.m_record.m_component.Get();
+				AActor* other_actor = other_component ? other_component->GetOwner() : nullptr;
+
+				// broadcast end overlapevent
+				if (OnComponentEndOverlap.IsBound())
+				{
+					OnComponentEndOverlap.Broadcast(this, other_actor, other_component, entry.m_record.m_item);
+				}
+				if (other_component && other_component->GetGenerateOverlapEvents())
+				{
+					other_component->OnComponentEndOverlap.Broadcast(other_component, Cast<AActor>(this->GetOwner()), this, -1);
+				}
 			}
 		}
-#endif
 	}
+}
 
-	if (m_style_type == ECollisionCompStyleType::LINE)
+void UTraceAndSweepCollisionComponent::ProcessForwardDiffEndOverlaps()
+{
+	// Forward hits include every blocking object the sweeps started inside of (zero distance, from the start overlaps), so anything still being touched is in there
+	for (int32 index = m_overlapped_results.Num() - 1; index >= 0; --index)
+	{
+		const FCollisionHitEntry& overlap = m_overlapped_results.GetEntries()[index];
+		if (m_forward_hit_results.Find(overlap.m_key)) continue;
+
+		// Copy before removing, removal moves last entry into this one
+		const FCollisionHitKey key = overlap.m_key;
+		const FCollisionHitRecord record = overlap.m_record;
+		m_overlapped_results.Remove(key);
+
+		if (FCollisionTelemetryCounters* counters = GetTelemetryCounters())
+		{
+			counters->m_num_end_overlaps++;
+		}
+
+		UPrimitiveComponent* other_component = record.m_component.Get();
+		AActor* other_actor = other_component ? other_component->GetOwner() : nullptr;
+
+		// broadcast end overlapevent
+		if (OnComponentEndOverlap.IsBound())
+		{
+			OnComponentEndOverlap.Broadcast(this, other_actor, other_component, record.m_item);
+		}
+		if (other_component && other_component->GetGenerateOverlapEvents())
+		{
+			other_component->OnComponentEndOverlap.Broadcast(other_component, Cast<AActor>(this->GetOwner()), this, -1);
+		}
+
+		// Event handlers can end more overlaps (Eg: by disabling collision)
+		index = FMath::Min(index, m_overlapped_results.Num());
+	}
+}
+
+void UTraceAndSweepCollisionComponent::SetTracePerSecond(float traces_per_second)
+{
+	m_traces_per_second = FMath::Max(0.0f, traces_per_second);
+	if (m_traces_per_second > 0.0f)
+	{
+		float trace_interval = 1.0f / m_traces_per_second;
+		m_tick_interval = trace_interval;
+		SetComponentTickInterval(trace_interval);
+	}
+	else
+	{
+		m_tick_interval = 0.0f;
+		SetComponentTickInterval(0.0f);
+	}
+}
+
+void UTraceAndSweepCollisionComponent::SetIsTraceCollisionEnabled(bool is_enabled)
+{
+	RemoveFromPendingBatch();
+	m_is_trace_collision_enabled = is_enabled;
+
+	if (m_is_trace_collision_enabled)
+	{
+		m_time_elapsed = m_tick_phase * m_tick_interval;
+
+		// If collision is enabled then save the locations as previous location so that trace starts from correct location
+		SnapshotPreviousTransforms();
+
+		// Same for component vs component pass, capsules from before collision was disabled would sweep the whole way since then
+		m_component_capsules.Reset();
+		m_previous_component_capsules.Reset();
+	}
+}
+
+FCollisionTelemetryCounters* UTraceAndSweepCollisionComponent::GetTelemetryCounters() const
+{
+	return m_telemetry ? &m_telemetry->GetCounters(m_telemetry_archetype) : nullptr;
+}
+
+void UTraceAndSweepCollisionComponent::RefreshTelemetryEventName()
+{
+	const AActor* owner = GetOwner();
+	m_telemetry_event_name = FString::Printf(TEXT("%s %s %s %s"),
+		owner ? *owner->GetClass()->GetName() : TEXT("None"),
+		*StaticEnum<ECollisionCompExecutionType>()->GetNameStringByValue(int64(m_execution_type)),
+		*StaticEnum<ECollisionCompStyleType>()->GetNameStringByValue(int64(m_style_type)),
+		*StaticEnum<ECollisionCompTraceType>()->GetNameStringByValue(int64(m_trace_type)));
+}
+
+void UTraceAndSweepCollisionComponent::ResetForReuse(const FTransform& transform)
+{
+	// Otherwise begin overlaps of a batch still in flight would fire for where the component was before the teleport
+	RemoveFromPendingBatch();
+
+	// Teleport, so that first trace starts from the new transform instead of sweeping from where the component was released
+	if (AActor* owner = GetOwner())
+	{
+		owner->SetActorTransform(transform, false, nullptr, ETeleportType::TeleportPhysics);
+	}
+	else
+	{
+		SetWorldTransform(transform, false, nullptr, ETeleportType::TeleportPhysics);
+	}
+
+	// Results of traces still in flight belong to previous use, they are dropped when they arrive since their handles aren't tracked anymore
+	if (m_telemetry)
+	{
+		m_telemetry->AddAsyncInFlight(-m_num_pending_async_traces);
+	}
+	m_async_trace_slots.Reset();
+	m_num_pending_async_traces = 0;
+	m_first_async_test = 0;
+	m_num_async_tests = 0;
+	m_is_previous_trace_complete = true;
+	for (FCollisionLineData& line_data : m_collision_line_data)
 	{
-		line_data_ptr = m_collision_line_data.FindByPredicate(
-			[&](const FCollisionLineData& other)
-			{
-				return other.m_reverse_trace_handle.IsValid() && other.m_reverse_trace_handle == handle;
-			});
+		line_data.m_forward_trace_handle = FTraceHandle();
+		line_data.m_reverse_trace_handle = FTraceHandle();
 	}
-	else if (m_style_type == ECollisionCompStyleType::SWEEP)
+	for (FCollisionShapeData& shape_data : m_collision_shape_data)
 	{
-		shape_data_ptr = m_collision_shape_data.FindByPredicate(
-			[&](const FCollisionShapeData& other)
-			{
-				return other.m_reverse_trace_handle.IsValid() && other.m_reverse_trace_handle == handle;
-			});
+		shape_data.m_forward_trace_handle = FTraceHandle();
+		shape_data.m_reverse_trace_handle = FTraceHandle();
 	}
 
-	if (line_data_ptr || shape_data_ptr)
+	ResetCollisionTestResults();
+	m_overlapped_results.Reset();
+	// Teleported, so don't let component vs component pass sweep from old location
+	m_component_capsules.Reset();
+	m_previous_component_capsules.Reset();
+	if (ATraceAndSweepCollisionManager* manager = m_manager.Get())
 	{
-		// Reverse trace
-		// Clear the handle
-		if (line_data_ptr)
-			line_data_ptr->m_reverse_trace_handle = FTraceHandle();
-		else if (shape_data_ptr)
-			shape_data_ptr->m_reverse_trace_handle = FTraceHandle();
+		manager->RemoveComponentOverlapPairs(m_manager_slot);
+	}
 
-		for (const FHitResult& reverse_hit : data.OutHits)
+	m_time_elapsed = m_tick_phase * m_tick_interval;
+	m_trace_lod = 0;
+
+	SnapshotPreviousTransforms();
+}
+
+FBox UTraceAndSweepCollisionComponent::CalcSweptBounds() const
+{
+	FBox bounds(ForceInit);
+
+	// When manager owns the transforms, previous location lives in the pool
+	auto get_previous_location = [this](int32 index, const FVector& data_location)
 		{
-			if (reverse_hit.bBlockingHit)
-			{
-				m_reverse_hit_results.AddUnique(reverse_hit);
-			}
-		}
-	}
+			return m_trace_pool && m_pool_slots.IsValidIndex(index) ? m_trace_pool->GetPreviousLocation(m_pool_slots[index]) : data_location;
+		};
 
-	// check if all the async traces are finished
-	bool is_all_traces_finished = true;
 	if (m_style_type == ECollisionCompStyleType::LINE)
 	{
-		for (const FCollisionLineData& line_data : m_collision_line_data)
+		const FLinePointSource source = MakeLinePointSource();
+		for (int32 index = 0; index < m_collision_line_data.Num(); ++index)
 		{
-			if (line_data.m_forward_trace_handle.IsValid() || line_data.m_reverse_trace_handle.IsValid())
+			const FCollisionLineData& line_data = m_collision_line_data[index];
+
+			FVector location = FVector::ZeroVector;
+			if (GetLinePointLocation(line_data, source, location))
 			{
-				is_all_traces_finished = false;
-				break;
+				bounds += location;
+				bounds += get_previous_location(index, line_data.m_prev_location);
 			}
 		}
+
+		// Path of ticks missed while async tests were in flight isn't traced yet either
+		for (const FCollisionStitchPoint& point : m_stitch_points)
+		{
+			bounds += point.m_location;
+		}
 	}
 	else if (m_style_type == ECollisionCompStyleType::SWEEP)
 	{
-		for (const FCollisionShapeData& shape_data : m_collision_shape_data)
+		const FTransform& comp_transform = GetComponentTransform();
+		const FCollisionSubStepSettings sub_step_settings = MakeSubStepSettings();
+
+		for (int32 index = 0; index < m_collision_shape_data.Num(); ++index)
 		{
-			if (shape_data.m_forward_trace_handle.IsValid() || shape_data.m_reverse_trace_handle.IsValid())
+			const FCollisionShapeData& shape_data = m_collision_shape_data[index];
+			const FTransform end_transform = shape_data.m_offset * comp_transform;
+			const bool is_pooled = m_trace_pool && m_pool_slots.IsValidIndex(index);
+
+			// Same legs that gathering makes, stitch points and then to where the shape is now. Sub steps of a leg follow an arc
+			// that can bulge out of the box of its end points, but the sub steps themselves are straight sweeps between their end points.
+			m_swept_bounds_segments.Reset();
+			FCollisionTraceSegment segment;
+			segment.m_start = is_pooled ? m_trace_pool->GetPreviousLocation(m_pool_slots[index]) : shape_data.m_prev_location;
+			segment.m_start_rotation = is_pooled ? m_trace_pool->GetPreviousRotation(m_pool_slots[index]) : shape_data.m_prev_rotation;
+
+			for (const FCollisionStitchPoint& point : m_stitch_points)
 			{
-				is_all_traces_finished = false;
-				break;
+				if (point.m_data_index != index) continue;
+
+				segment.m_end = point.m_location;
+				segment.m_end_rotation = point.m_rotation;
+				sub_step_settings.AppendSegments(segment, m_swept_bounds_segments);
+				segment.m_start = segment.m_end;
+				segment.m_start_rotation = segment.m_end_rotation;
 			}
-		}
-	}
 
-	// if all traces are completed then process the hit results.
-	if (is_all_traces_finished)
-	{
-		// All hit results are ready to be processed
-		ProcessForwardHitResults();
+			segment.m_end = end_transform.GetLocation();
+			segment.m_end_rotation = end_transform.GetRotation();
+			sub_step_settings.AppendSegments(segment, m_swept_bounds_segments);
 
-		if (m_should_generate_end_overlap)
-		{
-			ProcessReverseHitResults();
+			FBox shape_bounds(ForceInit);
+			for (const FCollisionTraceSegment& sub_step : m_swept_bounds_segments)
+			{
+				shape_bounds += sub_step.m_start;
+				shape_bounds += sub_step.m_end;
+			}
+
+			// Same radius as segments use, so the box holds the shape in any rotation
+			bounds += shape_bounds.ExpandBy(GetShapeExtent(shape_data).Size());
 		}
 	}
 
-	m_is_previous_trace_complete = is_all_traces_finished;
+	return bounds;
 }
 
-
-void UTraceAndSweepCollisionComponent::ProcessForwardHitResults()
+void UTraceAndSweepCollisionComponent::UpdateComponentCapsules()
 {
-	for (const FHitResultWrapper& result : m_forward_hit_results)
+	Swap(m_previous_component_capsules, m_component_capsules);
+	m_component_capsules.Reset();
+
+	if (m_style_type == ECollisionCompStyleType::LINE)
 	{
-		if (result.m_result.Distance != 0.0f)
+		const FLinePointSource source = MakeLinePointSource();
+		FVector previous_point = FVector::ZeroVector;
+		int32 num_points = 0;
+
+		for (const FCollisionLineData& line_data : m_collision_line_data)
 		{
-			int index = -1;
-			bool is_contain_result = m_overlapped_results.Find(result, index);
-			if (!is_contain_result)
-			{
-				index = m_overlapped_results.Add(result);
+			FVector point = FVector::ZeroVector;
+			if (!GetLinePointLocation(line_data, source, point)) continue;
 
-				// broadcast begin overlapevent
-				if (OnComponentBeginOverlap.IsBound())
-				{
-					OnComponentBeginOverlap.Broadcast(this, result.m_result.GetActor(), result.m_result.GetComponent(), result.m_result.Item, true, result.m_result);
-				}
-				if (result.m_result.GetComponent()->GetGenerateOverlapEvents())
-				{
-					result.m_result.GetComponent()->OnComponentBeginOverlap.Broadcast(result.m_result.GetComponent(), Cast<AActor>(this->GetOwner()), this, -1, true, result.m_result);
-				}
-			}
-			if (index != -1)
+			if (num_points > 0)
 			{
-				m_overlapped_results[index].m_count++;
+				m_component_capsules.Add({ previous_point, point, m_component_collision_radius });
 			}
+			previous_point = point;
+			++num_points;
 		}
-	}
 
-	if (!m_should_generate_end_overlap)
-	{
-		m_overlapped_results.Empty();
+		if (num_points == 1)
+		{
+			m_component_capsules.Add({ previous_point, previous_point, m_component_collision_radius });
+		}
 	}
-}
-
-void UTraceAndSweepCollisionComponent::ProcessReverseHitResults()
-{
-	for (const FHitResultWrapper& result : m_reverse_hit_results)
+	else if (m_style_type == ECollisionCompStyleType::SWEEP)
 	{
-		if (result.m_result.Distance != 0.0f)
+		const FTransform& comp_transform = GetComponentTransform();
+		for (const FCollisionShapeData& shape : m_collision_shape_data)
 		{
-			int32 index = -1;
-			bool is_contain_result = m_overlapped_results.Find(result, index);
-			if (is_contain_result)
+			const FTransform shape_transform = shape.m_offset * comp_transform;
+			const FVector center = shape_transform.GetLocation();
+			const FVector scale = shape_transform.GetScale3D().GetAbs();
+
+			FCollisionComponentCapsule& capsule = m_component_capsules.AddDefaulted_GetRef();
+			capsule.m_point_a = center;
+			capsule.m_point_b = center;
+
+			if (shape.m_shape_type == ECollisionCompShapeType::SPHERE)
 			{
-				m_overlapped_results[index].m_count--;
-				if (m_overlapped_results[index].m_count == 0)
-				{
-					m_overlapped_results.RemoveAtSwap(index, 1, EAllowShrinking::No);
+				capsule.m_radius = shape.m_sphere_radius * scale.GetMax();
+			}
+			else if (shape.m_shape_type == ECollisionCompShapeType::CAPSULE)
+			{
+				// Same constraints as bounds, radius is uniform and can't exceed half height
+				const float half_height = shape.m_capsule_half_height * scale.Z;
+				capsule.m_radius = FMath::Min(shape.m_capsule_radius * FMath::Max(scale.X, scale.Y), half_height);
 
-					// broadcast end overlapevent
-					if (OnComponentEndOverlap.IsBound())
-					{
-						OnComponentEndOverlap.Broadcast(this, result.m_result.GetActor(), result.m_result.GetComponent(), result.m_result.Item);
-					}
-					if (result.m_result.GetComponent()->GetGenerateOverlapEvents())
-					{
-						result.m_result.GetComponent()->OnComponentEndOverlap.Broadcast(result.m_result.GetComponent(), Cast<AActor>(this->GetOwner()), this, -1);
-					}
-				}
+				const FVector axis = shape_transform.GetUnitAxis(EAxis::Z) * (half_height - capsule.m_radius);
+				capsule.m_point_a = center - axis;
+				capsule.m_point_b = center + axis;
 			}
+			else if (shape.m_shape_type == ECollisionCompShapeType::BOX)
+			{
+				// Capsule along the longest axis that encloses the box
+				const FVector extent = shape.m_box_half_extent * scale;
+				const int32 long_axis = extent.X >= extent.Y && extent.X >= extent.Z ? 0 : (extent.Y >= extent.Z ? 1 : 2);
+				const float other_a = extent[(long_axis + 1) % 3];
+				const float other_b = extent[(long_axis + 2) % 3];
+				capsule.m_radius = FMath::Sqrt(other_a * other_a + other_b * other_b);
+
+				const FVector axis = shape_transform.GetUnitAxis(EAxis::Type(EAxis::X + long_axis)) * extent[long_axis];
+				capsule.m_point_a = center - axis;
+				capsule.m_point_b = center + axis;
+			}
+
+			capsule.m_radius += m_component_collision_radius;
 		}
 	}
-}
 
-void UTraceAndSweepCollisionComponent::SetTracePerSecond(float traces_per_second)
-{
-	m_traces_per_second = FMath::Max(0.0f, traces_per_second);
-	if (m_traces_per_second > 0.0f)
-	{
-		float trace_interval = 1.0f / m_traces_per_second;
-		m_tick_interval = trace_interval;
-		SetComponentTickInterval(trace_interval);
-	}
-	else
+	// Nothing to move from when lines or shapes changed, so they are tested where they are now
+	if (m_previous_component_capsules.Num() != m_component_capsules.Num())
 	{
-		m_tick_interval = 0.0f;
-		SetComponentTickInterval(0.0f);
+		m_previous_component_capsules = m_component_capsules;
 	}
 }
 
-void UTraceAndSweepCollisionComponent::SetIsTraceCollisionEnabled(bool is_enabled)
+bool UTraceAndSweepCollisionComponent::CanCollideWithComponent(const UTraceAndSweepCollisionComponent* other) const
 {
-	m_is_trace_collision_enabled = is_enabled;
+	const AActor* owner = GetOwner();
+	const AActor* other_owner = other->GetOwner();
 
-	if (m_is_trace_collision_enabled)
+	// Owner is always ignored, so two components of same owner never hit each other
+	if (owner == other_owner) return false;
+
+	if (m_ignored_actors.Contains(other_owner) || other->m_ignored_actors.Contains(owner)) return false;
+	if (m_ignored_components.Contains(other) || other->m_ignored_components.Contains(this)) return false;
+
+	return true;
+}
+
+void UTraceAndSweepCollisionComponent::SnapshotPreviousTransforms()
+{
+	RefreshSocketIndices();
+	const FLinePointSource source = MakeLinePointSource();
+	for (FCollisionLineData& line_data : m_collision_line_data)
 	{
-		m_time_elapsed = 0.0f;
+		GetLinePointLocation(line_data, source, line_data.m_prev_location);
+	}
 
-		// If collision is enabled then save the locations as previous location so that trace starts from correct location
-		const USkeletalMeshComponent* parent_skeletal_mesh = Cast<USkeletalMeshComponent>(GetAttachParent());
-		for (FCollisionLineData& line_data : m_collision_line_data)
-		{
-			if (line_data.m_scene_component_to_follow->IsValidLowLevel())
-			{
-				line_data.m_prev_location = line_data.m_scene_component_to_follow->GetComponentLocation();
-			}
-			else if (parent_skeletal_mesh && line_data.m_socket_name != NAME_None && parent_skeletal_mesh->DoesSocketExist(line_data.m_socket_name))
-			{
-				line_data.m_prev_location = parent_skeletal_mesh->GetSocketLocation(line_data.m_socket_name);
-			}
-		}
+	// For shapes save both location and rotation of the shape since rotation will effect the collision detection for shapes.
+	// Offset is relative to component, same order as when segments are gathered.
+	const FTransform comp_transform = GetComponentTransform();
+	for (FCollisionShapeData& shape_data : m_collision_shape_data)
+	{
+		const FTransform shape_transform = shape_data.m_offset * comp_transform;
+		shape_data.m_prev_location = shape_transform.GetLocation();
+		shape_data.m_prev_rotation = shape_transform.GetRotation();
+	}
 
-		// For shapes save both location and rotation of the shape since rotation will effect the collision detection for shapes
-		const FTransform comp_transform = GetComponentTransform();
-		for (FCollisionShapeData& shape_data : m_collision_shape_data)
-		{
-			const FTransform shape_transform = comp_transform * shape_data.m_offset;
-			shape_data.m_prev_location = shape_transform.GetLocation();
-			shape_data.m_prev_rotation = shape_transform.GetRotation();
-		}
+	// When manager owns the transforms, previous location lives in the pool
+	if (m_trace_pool)
+	{
+		WritePoolTransforms();
+		m_trace_pool->CommitSlots(m_pool_slots);
 	}
+
+	// Path up to here isn't traced anymore
+	m_stitch_points.Reset();
+	m_num_stitched_ticks = 0;
 }
 
 void UTraceAndSweepCollisionComponent::AddSceneComponentToTrace(USceneComponent* scene_component)
@@ -1192,9 +2230,15 @@ void UTraceAndSweepCollisionComponent::AddSceneComponentToTrace(USceneComponent*
 	// Add if the scene component isn't being followed
 	if (!data)
 	{
+		RemoveFromPendingBatch();
+
 		FCollisionLineData line_data;
 		line_data.m_scene_component_to_follow = scene_component;
+		line_data.m_prev_location = scene_component->GetComponentLocation();
 		m_collision_line_data.Add(line_data);
+		m_are_socket_indices_dirty = true;
+
+		RefreshPoolSlots();
 	}
 }
 
@@ -1299,328 +2343,210 @@ void UTraceAndSweepCollisionComponent::PostEditChangeChainProperty(FPropertyChan
 
 FPrimitiveSceneProxy* UTraceAndSweepCollisionComponent::CreateSceneProxy()
 {
-	/** Represents a UTraceAndSweepCollisionComponent to the scene manager. */
-	class FTraceAndSweepCollisionSceneProxy final : public FPrimitiveSceneProxy
-	{
-	public:
-		SIZE_T GetTypeHash() const override
-		{
-			static size_t UniquePointer;
-			return reinterpret_cast<size_t>(&UniquePointer);
-		}
-
-		FTraceAndSweepCollisionSceneProxy(const UTraceAndSweepCollisionComponent* comp)
-			: FPrimitiveSceneProxy(comp)
-			, m_comp(comp)
-		{
-			bWillEverBeLit = false;
-			bWantsSelectionOutline = true;
-			//bAlwaysVisible = true;
-		}
+	GatherDebugTransforms(m_debug_render_transforms);
+	return new FTraceAndSweepCollisionSceneProxy(this, MakeDebugRenderData(m_debug_render_transforms));
+}
 
-		virtual void GetDynamicMeshElements(const TArray<const FSceneView*>& Views, const FSceneViewFamily& ViewFamily, uint32 VisibilityMap, FMeshElementCollector& Collector) const override
-		{
-			SCOPE_CYCLE_COUNTER(STAT_TraceAndSweepCollisionSceneProxy_GetDynamicMeshElements);
+void UTraceAndSweepCollisionComponent::SendRenderDynamicData_Concurrent()
+{
+	Super::SendRenderDynamicData_Concurrent();
 
-			const FMatrix& local_to_world = GetLocalToWorld();
+	if (!SceneProxy) return;
 
-			for (int32 ViewIndex = 0; ViewIndex < Views.Num(); ViewIndex++)
-			{
-				if (VisibilityMap & (1 << ViewIndex))
-				{
-					const FSceneView* View = Views[ViewIndex];
+	GatherDebugTransforms(m_debug_scratch_transforms);
 
-					const FLinearColor color = GetViewSelectionColor(m_comp->m_debug_collision_shape_color, *View, IsSelected(), IsHovered(), false, IsIndividuallySelected());
-					FPrimitiveDrawInterface* PDI = Collector.GetPDI(ViewIndex);
+	// Render thread already has the data of unchanged transforms
+	bool is_changed = m_debug_scratch_transforms.Num() != m_debug_render_transforms.Num();
+	for (int32 index = 0; !is_changed && index < m_debug_scratch_transforms.Num(); ++index)
+	{
+		is_changed = !m_debug_scratch_transforms[index].Equals(m_debug_render_transforms[index]);
+	}
+	if (!is_changed) return;
 
-					if (m_comp->m_style_type == ECollisionCompStyleType::LINE)
-					{
-						for (const FCollisionLineData& line : m_comp->m_collision_line_data)
-						{
-							FTransform transform = FTransform::Identity;
-							bool is_valid_line_data = false;
-							if (line.m_scene_component_to_follow->IsValidLowLevel())
-							{
-								is_valid_line_data = true;
-								transform = line.m_scene_component_to_follow->GetComponentTransform();
-							}
-							else if (line.m_socket_name != NAME_None)
-							{
-								USkeletalMeshComponent* parent_component = Cast<USkeletalMeshComponent>(m_comp->GetAttachParent());
-								if (parent_component && parent_component->DoesSocketExist(line.m_socket_name))
-								{
-									is_valid_line_data = true;
-									transform = parent_component->GetSocketTransform(line.m_socket_name);
-								}
-							}
-
-							if (is_valid_line_data)
-							{
-								// nullify scale
-								transform.SetScale3D(FVector(1.0f, 1.0f, 1.0f));
-								float middle_gap = 1.0f;
-								FTransform temp = FTransform(FVector(-m_comp->m_debug_arrow_length - middle_gap, 0.0f, 0.0f)) * transform;
-								DrawDirectionalArrow(PDI, temp.ToMatrixNoScale(), color, m_comp->m_debug_arrow_length, 2, SDPG_World, m_comp->m_debug_thickness);
-
-								temp = FTransform(FQuat::MakeFromEuler(FVector(0.0f, 180.0f, 0.0f))) * FTransform(FVector(m_comp->m_debug_arrow_length + middle_gap, 0.0f, 0.0f)) * transform;
-								DrawDirectionalArrow(PDI, temp.ToMatrixNoScale(), color, m_comp->m_debug_arrow_length, 2, SDPG_World, m_comp->m_debug_thickness);
-
-								temp = FTransform(FQuat::MakeFromEuler(FVector(0.0f, -90.0f, 0.0f))) * FTransform(FVector(0.0f, 0.0f, m_comp->m_debug_arrow_length + middle_gap)) * transform;
-								DrawDirectionalArrow(PDI, temp.ToMatrixNoScale(), color, m_comp->m_debug_arrow_length, 2, SDPG_World, m_comp->m_debug_thickness);
-
-								temp = FTransform(FQuat::MakeFromEuler(FVector(0.0f, 90.0f, 0.0f))) * FTransform(FVector(0.0f, 0.0f, -m_comp->m_debug_arrow_length - middle_gap)) * transform;
-								DrawDirectionalArrow(PDI, temp.ToMatrixNoScale(), color, m_comp->m_debug_arrow_length, 2, SDPG_World, m_comp->m_debug_thickness);
-
-								temp = FTransform(FQuat::MakeFromEuler(FVector(0.0f, 0.0, 90.0f))) * FTransform(FVector(0.0f, -m_comp->m_debug_arrow_length - middle_gap, 0.0f)) * transform;
-								DrawDirectionalArrow(PDI, temp.ToMatrixNoScale(), color, m_comp->m_debug_arrow_length, 2, SDPG_World, m_comp->m_debug_thickness);
-
-								temp = FTransform(FQuat::MakeFromEuler(FVector(0.0f, 0.0, -90.0f))) * FTransform(FVector(0.0f, m_comp->m_debug_arrow_length + middle_gap, 0.0f)) * transform;
-								DrawDirectionalArrow(PDI, temp.ToMatrixNoScale(), color, m_comp->m_debug_arrow_length, 2, SDPG_World, m_comp->m_debug_thickness);
-							}
-						}
-					}
-					else if (m_comp->m_style_type == ECollisionCompStyleType::SWEEP)
-					{
-						for (const FCollisionShapeData& shape : m_comp->m_collision_shape_data)
-						{
-							const FMatrix& shape_transform = shape.m_offset.ToMatrixWithScale() * local_to_world;
-
-							if (shape.m_shape_type == ECollisionCompShapeType::BOX)
-							{
-								DrawWireBox(PDI
-									, shape_transform
-									, FBox(-shape.m_box_half_extent, shape.m_box_half_extent)
-									, color
-									, SDPG_World
-									, m_comp->m_debug_thickness);
-							}
-							else if (shape.m_shape_type == ECollisionCompShapeType::CAPSULE)
-							{
-								const FVector& comp_scale = (shape.m_offset * m_comp->GetComponentTransform()).GetScale3D();
-
-								FVector x, y, z;
-								shape_transform.GetUnitAxes(x, y, z);
-
-								// capsule should have uniform radius
-								const float height = shape.m_capsule_half_height * comp_scale.Z;
-								const float radius = shape.m_capsule_radius * FMath::Max(0.0f, FMath::Max(comp_scale.X, comp_scale.Y));
-
-								DrawWireCapsule(PDI
-									, shape_transform.GetOrigin()
-									, x
-									, y
-									, z
-									, color
-									, radius
-									, height
-									, 32
-									, SDPG_World
-									, m_comp->m_debug_thickness);
-							}
-							else if (shape.m_shape_type == ECollisionCompShapeType::SPHERE)
-							{
-								const FVector& comp_scale = (shape.m_offset * m_comp->GetComponentTransform()).GetScale3D();
-
-								// sphere should have uniform radius
-								const float max_scale = FMath::Max(0.0f, FMath::Max(comp_scale.X, FMath::Max(comp_scale.Y, comp_scale.Z)));
-								const float radius = shape.m_sphere_radius * max_scale;
-
-								DrawWireSphere(PDI
-									, shape_transform.GetOrigin()
-									, color
-									, radius
-									, FMath::Max(radius / 2.f, 20.f)
-									, SDPG_World
-									, m_comp->m_debug_thickness);
-							}
-						}
-					}
-				}
-			}
-		}
+	Swap(m_debug_render_transforms, m_debug_scratch_transforms);
 
-		virtual FPrimitiveViewRelevance GetViewRelevance(const FSceneView* View) const override
+	FTraceAndSweepCollisionSceneProxy* proxy = static_cast<FTraceAndSweepCollisionSceneProxy*>(SceneProxy);
+	ENQUEUE_RENDER_COMMAND(TraceAndSweepCollisionSendRenderData)(
+		[proxy, render_data = MakeDebugRenderData(m_debug_render_transforms)](FRHICommandListImmediate& RHICmdList) mutable
 		{
-			bool bDrawOnlyIfSelected = false;
-			const bool bProxyVisible = !bDrawOnlyIfSelected || IsSelected();
-
-			// Should we draw this because collision drawing is enabled, and we have collision
-			const bool bShowForCollision = View->Family->EngineShowFlags.Collision;
-
-			FPrimitiveViewRelevance Result;
-			Result.bDrawRelevance = (IsShown(View) && bProxyVisible) || bShowForCollision;
-			Result.bDynamicRelevance = true;
-			Result.bShadowRelevance = IsShadowCast(View);
-			Result.bEditorPrimitiveRelevance = UseEditorCompositing(View);
-			return Result;
-		}
-		virtual uint32 GetMemoryFootprint(void) const override { return(sizeof(*this) + FPrimitiveSceneProxy::GetAllocatedSize()); }
+			proxy->SetRenderData_RenderThread(MoveTemp(render_data));
+		});
+}
 
-	private:
-		const UTraceAndSweepCollisionComponent* m_comp = nullptr;
-	};
+void UTraceAndSweepCollisionComponent::OnUpdateTransform(EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport)
+{
+	Super::OnUpdateTransform(UpdateTransformFlags, Teleport);
 
-	return new FTraceAndSweepCollisionSceneProxy(this);
+	MarkDebugRenderDataDirty();
 }
 
+void UTraceAndSweepCollisionComponent::MarkDebugRenderDataDirty()
+{
+#if !UE_BUILD_SHIPPING
+	if (SceneProxy && m_debug_draw_collision_shape)
+	{
+		MarkRenderDynamicDataDirty();
+	}
+#endif
+}
 
-FBoxSphereBounds UTraceAndSweepCollisionComponent::CalcBounds(const FTransform& LocalToWorld) const
+void UTraceAndSweepCollisionComponent::GatherDebugTransforms(TArray<FTransform>& out_transforms) const
 {
-	FVector min_bound_point = FVector::ZeroVector;
-	FVector max_bound_point = FVector::ZeroVector;
+	out_transforms.Reset();
 
 	if (m_style_type == ECollisionCompStyleType::LINE)
 	{
-		bool is_first = true;
-
-		for (const FCollisionLineData& data : m_collision_line_data)
+		const FLinePointSource source = MakeLinePointSource();
+		for (const FCollisionLineData& line : m_collision_line_data)
 		{
-			FVector point_world_location = FVector::ZeroVector;
-			if (data.m_scene_component_to_follow)
+			FTransform transform = FTransform::Identity;
+			if (GetLinePointTransform(line, source, transform))
 			{
-				point_world_location = data.m_scene_component_to_follow->GetComponentLocation();
+				// nullify scale
+				transform.SetScale3D(FVector::OneVector);
+				out_transforms.Add(transform);
 			}
-			else if (data.m_socket_name != NAME_None)
-			{
-				const USkeletalMeshComponent* parent_skeletal_mesh = Cast<USkeletalMeshComponent>(GetAttachParent());
-				if (parent_skeletal_mesh)
-				{
-					point_world_location = parent_skeletal_mesh->GetSocketLocation(data.m_socket_name);
-				}
-			}
-
-			if (is_first)
-			{
-				min_bound_point = point_world_location;
-				max_bound_point = point_world_location;
-				is_first = false;
-			}
-
-			// Get min and max bounds
-			min_bound_point.X = FMath::Min(min_bound_point.X, point_world_location.X);
-			min_bound_point.Y = FMath::Min(min_bound_point.Y, point_world_location.Y);
-			min_bound_point.Z = FMath::Min(min_bound_point.Z, point_world_location.Z);
-
-			max_bound_point.X = FMath::Max(max_bound_point.X, point_world_location.X);
-			max_bound_point.Y = FMath::Max(max_bound_point.Y, point_world_location.Y);
-			max_bound_point.Z = FMath::Max(max_bound_point.Z, point_world_location.Z);
 		}
-
-
-		// buffer to show arrows for points so that arrows won't disappear when point is at corner or slightly out of view.
-		const FVector debug_arrow_buffer = FVector(m_debug_arrow_length, m_debug_arrow_length, m_debug_arrow_length);
-		min_bound_point -= debug_arrow_buffer;
-		max_bound_point += debug_arrow_buffer;
 	}
 	else if (m_style_type == ECollisionCompStyleType::SWEEP)
 	{
-		bool is_first = true;
-		FTransform comp_transform = GetComponentTransform();
-
+		const FTransform& comp_transform = GetComponentTransform();
 		for (const FCollisionShapeData& shape : m_collision_shape_data)
 		{
-			FVector min_shape_bound = FVector::ZeroVector;
-			FVector max_shape_bound = FVector::ZeroVector;
-			if (shape.m_shape_type == ECollisionCompShapeType::BOX || shape.m_shape_type == ECollisionCompShapeType::CAPSULE)
-			{
-				// Apply offset and component transform to convert each vertices of the box from local to world space
-				// and then get the smallest and largest coordinate of vertices to find the min and max bounds.
-				FTransform total_world_transform = shape.m_offset * comp_transform;
+			out_transforms.Add(shape.m_offset * comp_transform);
+		}
+	}
+}
 
-				FBox box;
-				if (shape.m_shape_type == ECollisionCompShapeType::BOX)
-				{
-					box = FBox(-shape.m_box_half_extent, shape.m_box_half_extent);
-				}
-				else if (shape.m_shape_type == ECollisionCompShapeType::CAPSULE)
-				{
-					// For capsule just construct a box around capsule and calculate bounds of the box
-					// Capsule has constraints:
-					//		Scale on X and Y axis should be same.
-					//		Radius cannot exceed half height after scaling both radius and half height
-					// Scale is applied here so that constraints can be imposed.
-					FVector world_scale = total_world_transform.GetScale3D();
-					double capsule_radius = shape.m_capsule_radius * FMath::Max(FMath::Abs(world_scale.X), FMath::Abs(world_scale.Y));
-					double half_height = shape.m_capsule_half_height * FMath::Abs(world_scale.Z);
-					capsule_radius = FMath::Clamp(capsule_radius, 0.f, half_height);	//cap radius based on total height
-					half_height = FMath::Max(capsule_radius, half_height);
-
-					FVector capsule_extent = FVector(capsule_radius, capsule_radius, half_height);
-					box = FBox(-capsule_extent, capsule_extent);
-
-					// Since scale is already being considered for calculating radius and height, remove it
-					total_world_transform.SetScale3D(FVector(1.0f, 1.0f, 1.0f));
-				}
+TUniquePtr<FCollisionDebugRenderData> UTraceAndSweepCollisionComponent::MakeDebugRenderData(TConstArrayView<FTransform> transforms) const
+{
+	TUniquePtr<FCollisionDebugRenderData> render_data = MakeUnique<FCollisionDebugRenderData>();
+	render_data->m_color = m_debug_collision_shape_color;
+	render_data->m_thickness = m_debug_thickness;
 
-				FVector vertices[8];
-				box.GetVertices(vertices);
+	if (!m_debug_draw_collision_shape) return render_data;
 
-				FTransform tmp = FTransform::Identity;
-				tmp.SetLocation(vertices[0]);
+	TArray<FCollisionDebugLine>& lines = render_data->m_lines;
 
-				tmp = tmp * total_world_transform;
+	if (m_style_type == ECollisionCompStyleType::LINE)
+	{
+		for (const FTransform& transform : transforms)
+		{
+			AddPointArrowLines(lines, transform, m_debug_arrow_length);
+		}
+	}
+	else if (m_style_type == ECollisionCompStyleType::SWEEP)
+	{
+		for (int32 index = 0; index < transforms.Num() && index < m_collision_shape_data.Num(); ++index)
+		{
+			const FCollisionShapeData& shape = m_collision_shape_data[index];
+			const FTransform& transform = transforms[index];
+			const FVector comp_scale = transform.GetScale3D();
+			const FVector center = transform.GetLocation();
 
-				FVector vertice_world_loc = tmp.GetLocation();
-				min_shape_bound = vertice_world_loc;
-				max_shape_bound = vertice_world_loc;
+			if (shape.m_shape_type == ECollisionCompShapeType::BOX)
+			{
+				AddBoxLines(lines, transform, shape.m_box_half_extent);
+			}
+			else if (shape.m_shape_type == ECollisionCompShapeType::CAPSULE)
+			{
+				// capsule should have uniform radius
+				const float height = shape.m_capsule_half_height * comp_scale.Z;
+				const float radius = shape.m_capsule_radius * FMath::Max(0.0f, FMath::Max(comp_scale.X, comp_scale.Y));
 
-				for (int i = 0; i < 8; ++i)
-				{
-					// Create a transform with just location set at the vertices
-					tmp = FTransform::Identity;
-					tmp.SetLocation(vertices[i]);
+				AddCapsuleLines(lines, center, transform.GetRotation(), radius, height);
+			}
+			else if (shape.m_shape_type == ECollisionCompShapeType::SPHERE)
+			{
+				// sphere should have uniform radius
+				const float max_scale = FMath::Max(0.0f, FMath::Max(comp_scale.X, FMath::Max(comp_scale.Y, comp_scale.Z)));
+				const float radius = shape.m_sphere_radius * max_scale;
 
-					// Apply world transform to the vertices to get the world location of vertices
-					tmp = tmp * total_world_transform;
+				AddSphereLines(lines, center, transform.GetRotation(), radius);
+			}
+		}
+	}
 
-					vertice_world_loc = tmp.GetLocation();
+	return render_data;
+}
 
-					// Get min and max bounds
-					min_shape_bound.X = FMath::Min(min_shape_bound.X, vertice_world_loc.X);
-					min_shape_bound.Y = FMath::Min(min_shape_bound.Y, vertice_world_loc.Y);
-					min_shape_bound.Z = FMath::Min(min_shape_bound.Z, vertice_world_loc.Z);
 
-					max_shape_bound.X = FMath::Max(max_shape_bound.X, vertice_world_loc.X);
-					max_shape_bound.Y = FMath::Max(max_shape_bound.Y, vertice_world_loc.Y);
-					max_shape_bound.Z = FMath::Max(max_shape_bound.Z, vertice_world_loc.Z);
-				}
-			}
-			else if (shape.m_shape_type == ECollisionCompShapeType::SPHERE)
-			{
-				// Apply offset and component transform to convert sphere from local to world space
-				// NOTE: Rotation doesn't matter for sphere
-				FTransform sphere_world_transform = shape.m_offset * comp_transform;
-				FVector origin = sphere_world_transform.GetLocation();
+FBoxSphereBounds UTraceAndSweepCollisionComponent::CalcBounds(const FTransform& LocalToWorld) const
+{
+	if (!ShouldCalcDebugBounds())
+	{
+		return FBoxSphereBounds(LocalToWorld.GetLocation(), FVector::ZeroVector, 0.0f);
+	}
 
-				float world_scale = FMath::Max(0, sphere_world_transform.GetScale3D().GetMax());
-				float effective_radius = shape.m_sphere_radius * world_scale;
+	FBox bounds(ForceInit);
 
-				min_shape_bound = origin - FVector(effective_radius, effective_radius, effective_radius);
-				max_shape_bound = origin + FVector(effective_radius, effective_radius, effective_radius);
+	if (m_style_type == ECollisionCompStyleType::LINE)
+	{
+		const FLinePointSource source = MakeLinePointSource();
+		for (const FCollisionLineData& data : m_collision_line_data)
+		{
+			FVector point_world_location = FVector::ZeroVector;
+			if (GetLinePointLocation(data, source, point_world_location))
+			{
+				bounds += point_world_location;
 			}
+		}
 
-			if (is_first)
+		// buffer to show arrows for points so that arrows won't disappear when point is at corner or slightly out of view.
+		bounds = bounds.ExpandBy(m_debug_arrow_length);
+	}
+	else if (m_style_type == ECollisionCompStyleType::SWEEP)
+	{
+		if (LocalToWorld.GetScale3D().GetAbs().AllComponentsEqual())
+		{
+			// Uniform scale scales every shape the same way, so cached bounds only need one transform
+			bounds = m_local_shape_bounds.TransformBy(LocalToWorld);
+		}
+		else
+		{
+			// Capsules and spheres stay round under non uniform scale, so each shape has to be done in world space
+			for (const FCollisionShapeData& shape : m_collision_shape_data)
 			{
-				min_bound_point = min_shape_bound;
-				max_bound_point = max_shape_bound;
-				is_first = false;
+				bounds += CalcShapeBounds(shape, LocalToWorld);
 			}
-
-			min_bound_point.X = FMath::Min(min_bound_point.X, min_shape_bound.X);
-			min_bound_point.Y = FMath::Min(min_bound_point.Y, min_shape_bound.Y);
-			min_bound_point.Z = FMath::Min(min_bound_point.Z, min_shape_bound.Z);
-
-			max_bound_point.X = FMath::Max(max_bound_point.X, max_shape_bound.X);
-			max_bound_point.Y = FMath::Max(max_bound_point.Y, max_shape_bound.Y);
-			max_bound_point.Z = FMath::Max(max_bound_point.Z, max_shape_bound.Z);
 		}
 
 		// buffer to consider line thickness
-		const FVector debug_line_thickness_buffer = FVector(m_debug_thickness, m_debug_thickness, m_debug_thickness);
-		min_bound_point -= debug_line_thickness_buffer;
-		max_bound_point += debug_line_thickness_buffer;
+		bounds = bounds.ExpandBy(m_debug_thickness);
+	}
+
+	if (!bounds.IsValid)
+	{
+		return FBoxSphereBounds(LocalToWorld.GetLocation(), FVector::ZeroVector, 0.0f);
 	}
 
 	// bounds are calculated in world space so don't need to convert them here.
-	return FBoxSphereBounds(FBox(min_bound_point, max_bound_point));
+	return FBoxSphereBounds(bounds);
+}
+
+bool UTraceAndSweepCollisionComponent::ShouldCalcDebugBounds() const
+{
+#if UE_BUILD_SHIPPING
+	return false;
+#else
+	if (!IsVisible()) return false;
+	if (!m_debug_draw_collision_shape && !m_debug_draw_trace_lines && !m_debug_draw_sweep_shape) return false;
+
+	// Hidden in game components only show up in game with "show collision", then they need real bounds too or their debug proxy is culled.
+	// Show flag isn't watched, bounds pick it up on next transform update.
+	const UWorld* world = GetWorld();
+	if (!bHiddenInGame || !world || !world->IsGameWorld()) return true;
+
+	const UGameViewportClient* viewport = world->GetGameViewport();
+	return viewport && viewport->EngineShowFlags.Collision;
+#endif
+}
+
+void UTraceAndSweepCollisionComponent::RefreshLocalShapeBounds()
+{
+	m_local_shape_bounds = FBox(ForceInit);
+	for (const FCollisionShapeData& shape : m_collision_shape_data)
+	{
+		m_local_shape_bounds += CalcShapeBounds(shape, FTransform::Identity);
+	}
 }
@@ -1,5 +1,38 @@
 #include "TraceAndSweepCollisionManager.h"
 #include "TraceAndSweepCollisionComponent.h"
+#include "TraceAndSweepCollisionSubsystem.h"
+#include "TraceAndSweepCollisionNarrowPhase.h"
+#include "TraceAndSweepCollisionTelemetry.h"
+
+#include "Async/ParallelFor.h"
+#include "Algo/StableSort.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/MemoryBase.h"
+#include "HAL/LowLevelMemTracker.h"
+#include "Misc/CoreDelegates.h"
+
+//For Unreal Profiler
+DECLARE_CYCLE_STAT(TEXT("TickBatched"), STAT_TickBatched, STATGROUP_TraceAndSweepCollisionComponent);
+DECLARE_CYCLE_STAT(TEXT("TickBatched_Gather"), STAT_TickBatched_Gather, STATGROUP_TraceAndSweepCollisionComponent);
+DECLARE_CYCLE_STAT(TEXT("TickBatched_Execute"), STAT_TickBatched_Execute, STATGROUP_TraceAndSweepCollisionComponent);
+DECLARE_CYCLE_STAT(TEXT("TickBatched_Dispatch"), STAT_TickBatched_Dispatch, STATGROUP_TraceAndSweepCollisionComponent);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Batched Segments"), STAT_BatchedSegments, STATGROUP_TraceAndSweepCollisionComponent);
+DECLARE_CYCLE_STAT(TEXT("DispatchAsyncTraces"), STAT_DispatchAsyncTraces, STATGROUP_TraceAndSweepCollisionComponent);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Dispatched Async Traces"), STAT_DispatchedAsyncTraces, STATGROUP_TraceAndSweepCollisionComponent);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Async Trace Queue Overflow"), STAT_AsyncTraceQueueOverflow, STATGROUP_TraceAndSweepCollisionComponent);
+DECLARE_CYCLE_STAT(TEXT("ScheduleComponents"), STAT_ScheduleComponents, STATGROUP_TraceAndSweepCollisionComponent);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Scheduled Components"), STAT_ScheduledComponents, STATGROUP_TraceAndSweepCollisionComponent);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Deferred Components"), STAT_DeferredComponents, STATGROUP_TraceAndSweepCollisionComponent);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Trace LOD Components"), STAT_TraceLodComponents, STATGROUP_TraceAndSweepCollisionComponent);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Swept Volume Culled Components"), STAT_SweptVolumeCulledComponents, STATGROUP_TraceAndSweepCollisionComponent);
+DECLARE_CYCLE_STAT(TEXT("TickComponentCollision"), STAT_TickComponentCollision, STATGROUP_TraceAndSweepCollisionComponent);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Component Collision Capsules"), STAT_ComponentCollisionCapsules, STATGROUP_TraceAndSweepCollisionComponent);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Frame Budget Used (us)"), STAT_FrameBudgetUsed, STATGROUP_TraceAndSweepCollisionComponent);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Process Allocations During Tick"), STAT_ProcessAllocationsDuringTick, STATGROUP_TraceAndSweepCollisionComponent);
+
+// Memory of the manager, its components and the engine queries they make, see "stat LLM" with -llm
+LLM_DEFINE_TAG(TraceAndSweepCollision);
 
 // Sets default values
 ATraceAndSweepCollisionManager::ATraceAndSweepCollisionManager()
@@ -8,33 +41,974 @@ ATraceAndSweepCollisionManager::ATraceAndSweepCollisionManager()
 	PrimaryActorTick.bCanEverTick = true;
 }
 
+void ATraceAndSweepCollisionManager::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	// Before any component's BeginPlay, so that delegate is ready when they register. Queue is only allocated once an asynchronous component registers.
+	m_async_trace_delegate.BindUObject(this, &ATraceAndSweepCollisionManager::OnAsyncTraceComplete);
+	m_async_overlap_delegate.BindUObject(this, &ATraceAndSweepCollisionManager::OnAsyncOverlapComplete);
+
+	if (UTraceAndSweepCollisionSubsystem* subsystem = GetWorld()->GetSubsystem<UTraceAndSweepCollisionSubsystem>())
+	{
+		subsystem->SetManager(this);
+	}
+
+	if (m_overlap_batch_with_other_worlds)
+	{
+		// Last in the world's frame, so that nothing else in this world changes the components while their batch is traced
+		SetTickGroup(TG_PostUpdateWork);
+
+		// End of frame is after every world has ticked, garbage collection can come before that and must not free a component being traced
+		m_end_frame_handle = FCoreDelegates::OnEndFrame.AddUObject(this, &ATraceAndSweepCollisionManager::FinishPendingBatch);
+		m_pre_garbage_collect_handle = FCoreUObjectDelegates::GetPreGarbageCollectDelegate().AddUObject(this, &ATraceAndSweepCollisionManager::WaitForPendingBatch);
+	}
+}
+
+void ATraceAndSweepCollisionManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// Results of a batch in flight are dropped, components are leaving play too
+	WaitForPendingBatch();
+	m_pending_batch_task = UE::Tasks::FTask();
+	m_is_component_collision_pending = false;
+	FCoreDelegates::OnEndFrame.Remove(m_end_frame_handle);
+	FCoreUObjectDelegates::GetPreGarbageCollectDelegate().Remove(m_pre_garbage_collect_handle);
+
+	// Components can outlive the manager (Eg: manager destroyed on its own), they must not keep pointers into its broad phase, trace pool or telemetry
+	for (UTraceAndSweepCollisionComponent* comp : m_components)
+	{
+		if (comp)
+		{
+			UnregisterComponent(comp);
+		}
+	}
+
+	if (UTraceAndSweepCollisionSubsystem* subsystem = GetWorld()->GetSubsystem<UTraceAndSweepCollisionSubsystem>())
+	{
+		subsystem->ClearManager(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
 // Called every frame
 void ATraceAndSweepCollisionManager::Tick(float delta_time)
 {
 	Super::Tick(delta_time);
 
-	for (UTraceAndSweepCollisionComponent* comp : m_components)
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(TraceAndSweepCollisionManager_Tick, TraceAndSweepCollisionChannel);
+	LLM_SCOPE_BYTAG(TraceAndSweepCollision);
+
+	// Normally already done at end of last frame, but it has to be before broad phase and the batch buffers are touched again
+	FinishPendingBatch();
+
+#if STATS && !UE_BUILD_SHIPPING
+	// Allocator totals are process wide, so this also counts every other thread (render thread, async traces, task workers) during the tick.
+	// It's only an upper bound of the manager's own allocations. Use the TraceAndSweepCollision LLM tag to see the manager's own memory.
+	const uint64 start_allocations = FMalloc::TotalMallocCalls + FMalloc::TotalReallocCalls;
+#endif
+
+	// Everything from here on counts against the frame budget
+	m_frame_start_cycles = FPlatformTime::Cycles64();
+
+	// Async traces of last frame complete before actors tick, so their results are handed out before new ones are started
+	DispatchAsyncTraces();
+
+	// Targets only move on game thread, so bounds stay valid for all the traces of this tick
+	m_broad_phase.UpdateTargets();
+
+	ScheduleComponents(delta_time);
+
+	if (m_use_batched_execution || m_use_trace_pool)
+	{
+		TickBatched();
+	}
+	else
+	{
+		TickScheduled();
+	}
+
+	// Component pass fires events too, with a batch in flight it waits until the batch is dispatched so events fire in the same order either way
+	if (m_pending_batch_task.IsValid())
+	{
+		m_is_component_collision_pending = true;
+	}
+	else
+	{
+		TickComponentCollision();
+	}
+
+	UpdateTraceLods();
+
+	const double tick_seconds = FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - m_frame_start_cycles);
+	if (m_pending_batch_task.IsValid())
+	{
+		m_pending_tick_seconds = tick_seconds;
+	}
+	else
+	{
+		m_telemetry.AddTickCost(tick_seconds);
+	}
+
+#if STATS && !UE_BUILD_SHIPPING
+	SET_DWORD_STAT(STAT_ProcessAllocationsDuringTick, FMalloc::TotalMallocCalls + FMalloc::TotalReallocCalls - start_allocations);
+#endif
+}
+
+void ATraceAndSweepCollisionManager::ScheduleComponents(float delta_time)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ScheduleComponents);
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(TraceAndSweepCollisionManager_ScheduleComponents, TraceAndSweepCollisionChannel);
+
+	m_scheduled_components.Reset();
+	m_swept_volume_grid.Reset(m_swept_volume_cell_size);
+
+	const bool is_budgeted = m_frame_budget_us > 0.0f;
+	if (is_budgeted)
+	{
+		GatherViewLocations();
+	}
+
+	for (int32 index = 0; index < m_components.Num(); ++index)
+	{
+		// Late async results are traced again before scheduling, so the component can start a new test this frame. Its events can unregister it.
+		if (m_components[index] && m_components[index]->m_num_async_tests > 0)
+		{
+			m_components[index]->EnforceAsyncResultLatency();
+		}
+
+		UTraceAndSweepCollisionComponent* comp = m_components[index];
+		if (!comp || !comp->IsTraceCollisionEnabled()) continue;
+
+		comp->m_time_elapsed += delta_time;
+
+		// Trace LOD stretches the interval, components that trace every frame are stretched by frame time
+		const float base_interval = FMath::Max(comp->m_tick_interval, delta_time);
+		const float interval = comp->m_trace_lod > 0 ? base_interval * (1 + comp->m_trace_lod) : comp->m_tick_interval;
+		const bool is_due = comp->m_time_elapsed >= interval;
+
+		const bool needs_swept_bounds = m_use_swept_volume_grid || (is_due && comp->m_use_broad_phase);
+		const FBox swept_bounds = needs_swept_bounds ? comp->CalcSweptBounds() : FBox(ForceInit);
+		if (m_use_swept_volume_grid)
+		{
+			m_swept_volume_grid.Add(index, swept_bounds);
+		}
+
+		if (!is_due) continue;
+
+		FScheduledComponent scheduled;
+		scheduled.m_component = comp;
+		scheduled.m_index = index;
+		scheduled.m_interval = interval;
+
+		// Whole path is away from every target, so every segment would be skipped by broad phase anyway.
+		// Overlapped components still run to get their end overlaps. Path is consumed so next test doesn't sweep it again.
+		if (comp->m_use_broad_phase && comp->m_is_previous_trace_complete && comp->m_overlapped_results.Num() == 0 && !m_broad_phase.OverlapsAnyTarget(swept_bounds))
+		{
+			INC_DWORD_STAT(STAT_SweptVolumeCulledComponents);
+			comp->SnapshotPreviousTransforms();
+			ConsumeTickInterval(scheduled);
+			continue;
+		}
+
+		scheduled.m_priority = is_budgeted ? GetSchedulePriority(comp, base_interval) : 0.0f;
+		m_scheduled_components.Add(scheduled);
+	}
+
+	m_swept_volume_grid.Build();
+
+	if (is_budgeted)
+	{
+		// Ties are broken by manager slot, so same state always gives same schedule
+		m_scheduled_components.Sort([](const FScheduledComponent& a, const FScheduledComponent& b)
+			{
+				return a.m_priority != b.m_priority ? a.m_priority > b.m_priority : a.m_index < b.m_index;
+			});
+	}
+
+	m_num_run_components = m_scheduled_components.Num();
+	SET_DWORD_STAT(STAT_ScheduledComponents, m_scheduled_components.Num());
+}
+
+void ATraceAndSweepCollisionManager::GatherViewLocations()
+{
+	m_view_locations.Reset();
+
+	UWorld* world = GetWorld();
+	if (!world) return;
+
+	for (FConstPlayerControllerIterator iterator = world->GetPlayerControllerIterator(); iterator; ++iterator)
+	{
+		const APlayerController* player_controller = iterator->Get();
+		if (player_controller && player_controller->IsLocalController())
+		{
+			FVector view_location;
+			FRotator view_rotation;
+			player_controller->GetPlayerViewPoint(view_location, view_rotation);
+			m_view_locations.Add(view_location);
+		}
+	}
+}
+
+float ATraceAndSweepCollisionManager::GetSchedulePriority(const UTraceAndSweepCollisionComponent* comp, float interval) const
+{
+	float priority = comp->m_schedule_priority;
+
+	// Grows while component is deferred, so low priority components still get to run eventually
+	priority *= comp->m_time_elapsed / FMath::Max(interval, UE_KINDA_SMALL_NUMBER);
+
+	// Closer to any local player is more important
+	if (m_view_locations.Num() > 0)
+	{
+		const FVector location = comp->GetComponentLocation();
+
+		float min_distance_squared = UE_BIG_NUMBER;
+		for (const FVector& view_location : m_view_locations)
+		{
+			min_distance_squared = FMath::Min(min_distance_squared, FVector::DistSquared(location, view_location));
+		}
+
+		priority /= 1.0f + FMath::Sqrt(min_distance_squared) / FMath::Max(m_priority_reference_distance, 1.0f);
+	}
+
+	// Faster moving components cover more ground between traces, so they are more important
+	if (const AActor* owner = comp->GetOwner())
+	{
+		priority *= 1.0f + owner->GetVelocity().Size() / FMath::Max(m_priority_reference_speed, 1.0f);
+	}
+
+	return priority;
+}
+
+bool ATraceAndSweepCollisionManager::IsOverBudget(double estimated_us /* = 0.0*/) const
+{
+	if (m_frame_budget_us <= 0.0f) return false;
+
+	return GetSpentBudget() + estimated_us >= m_frame_budget_us;
+}
+
+double ATraceAndSweepCollisionManager::GetSpentBudget() const
+{
+	return FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - m_frame_start_cycles) * 1.0e6;
+}
+
+void ATraceAndSweepCollisionManager::ConsumeTickInterval(const FScheduledComponent& scheduled) const
+{
+	UTraceAndSweepCollisionComponent* comp = scheduled.m_component;
+	if (scheduled.m_interval > 0.0f)
+	{
+		// Whole intervals missed during a hitch or while deferred are dropped, the sweep already covers them
+		comp->m_time_elapsed = FMath::Fmod(comp->m_time_elapsed, scheduled.m_interval);
+	}
+	else
 	{
-		if (comp->IsTraceCollisionEnabled())
+		comp->m_time_elapsed = 0.0f;
+	}
+}
+
+void ATraceAndSweepCollisionManager::TickScheduled()
+{
+	for (int32 index = 0; index < m_scheduled_components.Num(); ++index)
+	{
+		// Highest priority component always runs, so there is progress even if budget is already gone
+		if (index > 0 && IsOverBudget())
 		{
-			comp->m_time_elapsed += delta_time;
-			if (comp->m_time_elapsed >= comp->m_tick_interval)
+			m_num_run_components = index;
+			break;
+		}
+
+		// Overlap event of a previous component could have destroyed this one
+		UTraceAndSweepCollisionComponent* comp = m_scheduled_components[index].m_component;
+		if (!IsValid(comp)) continue;
+
+		ConsumeTickInterval(m_scheduled_components[index]);
+		comp->ExternalTick();
+	}
+}
+
+// Deferred components keep their elapsed time and previous locations, so when they run their sweep covers the whole time they were waiting
+void ATraceAndSweepCollisionManager::UpdateTraceLods()
+{
+	const int32 num_deferred = m_scheduled_components.Num() - m_num_run_components;
+	SET_DWORD_STAT(STAT_DeferredComponents, num_deferred);
+
+	if (m_frame_budget_us <= 0.0f) return;
+
+	const double spent_us = GetSpentBudget();
+	SET_FLOAT_STAT(STAT_FrameBudgetUsed, spent_us);
+
+	// Lower LOD of components that ran only when there is plenty of budget left, so LOD doesn't flip every frame
+	const bool has_headroom = spent_us < m_frame_budget_us * 0.5;
+
+	for (int32 index = 0; index < m_scheduled_components.Num(); ++index)
+	{
+		UTraceAndSweepCollisionComponent* comp = m_scheduled_components[index].m_component;
+		if (!IsValid(comp)) continue;
+
+		if (index >= m_num_run_components)
+		{
+			comp->m_trace_lod = FMath::Min(comp->m_trace_lod + 1, m_max_trace_lod);
+		}
+		else if (has_headroom)
+		{
+			comp->m_trace_lod = FMath::Max(comp->m_trace_lod - 1, 0);
+		}
+	}
+
+#if STATS
+	int32 num_lod_components = 0;
+	for (const UTraceAndSweepCollisionComponent* comp : m_components)
+	{
+		num_lod_components += comp && comp->m_trace_lod > 0 ? 1 : 0;
+	}
+	SET_DWORD_STAT(STAT_TraceLodComponents, num_lod_components);
+#endif
+}
+
+void ATraceAndSweepCollisionManager::TickBatched()
+{
+	SCOPE_CYCLE_COUNTER(STAT_TickBatched);
+
+	UWorld* world = GetWorld();
+	if (!world) return;
+
+	m_batched_components.Reset();
+	m_batched_params.Reset();
+	m_batched_segments.Reset();
+	m_batched_segment_owners.Reset();
+
+	// Gather segments of every due component into one flat buffer
+	{
+		SCOPE_CYCLE_COUNTER(STAT_TickBatched_Gather);
+		TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(TraceAndSweepCollisionManager_TickBatched_Gather, TraceAndSweepCollisionChannel);
+
+		m_component_batch_indices.Init(INDEX_NONE, m_components.Num());
+
+		// Segments are traced after gathering, so their cost is estimated from previous frames
+		double estimated_us = 0.0;
+
+		for (int32 scheduled_index = 0; scheduled_index < m_scheduled_components.Num(); ++scheduled_index)
+		{
+			if (scheduled_index > 0 && IsOverBudget(estimated_us))
+			{
+				m_num_run_components = scheduled_index;
+				break;
+			}
+
+			const int32 index = m_scheduled_components[scheduled_index].m_index;
+			// Overlap event of a previous component could have destroyed this one
+			UTraceAndSweepCollisionComponent* comp = m_scheduled_components[scheduled_index].m_component;
+			if (!IsValid(comp)) continue;
+
+			ConsumeTickInterval(m_scheduled_components[scheduled_index]);
+
+			// Asynchronous traces are already off game thread, so let them go through the usual path
+			if (comp->m_execution_type == ECollisionCompExecutionType::ASYNCHRONOUS)
 			{
-				comp->m_time_elapsed = 0.0f;
 				comp->ExternalTick();
+				continue;
+			}
+
+			if (!comp->m_is_previous_trace_complete) continue;
+
+			comp->ResetCollisionTestResults();
+			comp->m_is_previous_trace_complete = false;
+
+			const int32 comp_index = m_batched_components.Add(comp);
+			m_batched_params.Add(&comp->GetQueryParams());
+			m_component_batch_indices[index] = comp_index;
+
+			if (comp->m_trace_pool)
+			{
+				// Segments are made below for all pooled components at once
+				comp->WritePoolTransforms();
+				estimated_us += comp->m_pool_slots.Num() * m_estimated_segment_cost_us;
+				continue;
+			}
+
+			const int32 first_segment = m_batched_segments.Num();
+			comp->GatherTraceSegments(m_batched_segments);
+			for (int32 i = first_segment; i < m_batched_segments.Num(); ++i)
+			{
+				m_batched_segment_owners.Add(comp_index);
+			}
+			estimated_us += (m_batched_segments.Num() - first_segment) * m_estimated_segment_cost_us;
+		}
+
+		if (m_use_trace_pool)
+		{
+			// Owners from pool are indices into m_components, convert them to batch indices
+			const int32 first_segment = m_batched_segments.Num();
+			m_trace_pool.SweepAllSlots(m_batched_segments, m_batched_segment_owners);
+			for (int32 i = first_segment; i < m_batched_segment_owners.Num(); ++i)
+			{
+				m_batched_segment_owners[i] = m_component_batch_indices[m_batched_segment_owners[i]];
 			}
 		}
 	}
+
+	const int32 num_segments = m_batched_segments.Num();
+	SET_DWORD_STAT(STAT_BatchedSegments, num_segments);
+
+	// Grow the result buffer only when needed, hit arrays inside are reused between frames
+	if (m_batched_results.Num() < num_segments)
+	{
+		m_batched_results.SetNum(num_segments);
+	}
+
+	// Other worlds tick while this batch is traced, results are dispatched at end of frame
+	if (m_overlap_batch_with_other_worlds && m_use_batched_execution && num_segments > 0)
+	{
+		m_pending_batch_task = UE::Tasks::Launch(UE_SOURCE_LOCATION, [this, world]()
+			{
+				LLM_SCOPE_BYTAG(TraceAndSweepCollision);
+				ExecuteBatch(world);
+			});
+		return;
+	}
+
+	ExecuteBatch(world);
+	DispatchBatch(world);
+}
+
+void ATraceAndSweepCollisionManager::ExecuteBatch(UWorld* world)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TickBatched_Execute);
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(TraceAndSweepCollisionManager_TickBatched_Execute, TraceAndSweepCollisionChannel);
+
+	const uint64 execute_start_cycles = FPlatformTime::Cycles64();
+	const int32 num_segments = m_batched_segments.Num();
+
+	// Trace pool can be used without batched execution, in which case traces stay on game thread
+	const EParallelForFlags parallel_for_flags = m_use_batched_execution ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread;
+
+	// Each segment writes into its own result slot so worker threads never touch the same memory
+	ParallelFor(TEXT("TraceAndSweepCollision.TickBatched"), num_segments, m_min_segments_per_worker,
+		[this, world](int32 index)
+		{
+			const int32 comp_index = m_batched_segment_owners[index];
+			FBatchedTraceResult& result = m_batched_results[index];
+			result.m_forward_hits.Reset();
+			result.m_reverse_hits.Reset();
+
+			result.m_num_traces = m_batched_components[comp_index]->ExecuteTraceSegment(world, m_batched_segments[index], *m_batched_params[comp_index], result.m_forward_hits, result.m_reverse_hits);
+		}, parallel_for_flags);
+
+	m_batch_execute_cycles = FPlatformTime::Cycles64() - execute_start_cycles;
+}
+
+void ATraceAndSweepCollisionManager::DispatchBatch(UWorld* world)
+{
+	const uint64 dispatch_start_cycles = FPlatformTime::Cycles64();
+	const int32 num_segments = m_batched_segments.Num();
+
+	// Back on game thread, hand the results to the components in the order they were gathered and fire the events.
+	// Order only depends on the order components were scheduled in, not on how worker threads ran, so results are same every run.
+	{
+		SCOPE_CYCLE_COUNTER(STAT_TickBatched_Dispatch);
+		TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(TraceAndSweepCollisionManager_TickBatched_Dispatch, TraceAndSweepCollisionChannel);
+
+		for (int32 index = 0; index < num_segments; ++index)
+		{
+			// Null if component was unregistered while its batch was in flight
+			UTraceAndSweepCollisionComponent* comp = m_batched_components[m_batched_segment_owners[index]];
+			if (!comp) continue;
+
+			const FBatchedTraceResult& result = m_batched_results[index];
+			if (FCollisionTelemetryCounters* counters = comp->GetTelemetryCounters())
+			{
+				counters->m_num_traces += result.m_num_traces;
+			}
+			comp->ResolveTraceSegment(world, m_batched_segments[index], result.m_forward_hits, result.m_reverse_hits);
+		}
+
+		for (UTraceAndSweepCollisionComponent* comp : m_batched_components)
+		{
+			// Overlap event of a previous component could have destroyed this one
+			if (IsValid(comp))
+			{
+				comp->FinishCollisionTest();
+			}
+		}
+	}
+
+	// Smoothed so that one slow frame doesn't throttle the next ones too much
+	if (num_segments > 0)
+	{
+		const uint64 batch_cycles = m_batch_execute_cycles + FPlatformTime::Cycles64() - dispatch_start_cycles;
+		const double segment_seconds = FPlatformTime::ToSeconds64(batch_cycles) / num_segments;
+		m_estimated_segment_cost_us = FMath::Lerp(m_estimated_segment_cost_us, segment_seconds * 1.0e6, 0.1);
+
+		// Segments of different components are traced together, so each one is charged the average
+		for (int32 index = 0; index < num_segments; ++index)
+		{
+			UTraceAndSweepCollisionComponent* comp = m_batched_components[m_batched_segment_owners[index]];
+			FCollisionTelemetryCounters* counters = IsValid(comp) ? comp->GetTelemetryCounters() : nullptr;
+			if (counters)
+			{
+				counters->m_seconds += segment_seconds;
+			}
+		}
+	}
+}
+
+void ATraceAndSweepCollisionManager::WaitForPendingBatch()
+{
+	if (m_pending_batch_task.IsValid())
+	{
+		m_pending_batch_task.Wait();
+	}
+}
+
+void ATraceAndSweepCollisionManager::RemoveFromPendingBatch(UTraceAndSweepCollisionComponent* component)
+{
+	if (!m_pending_batch_task.IsValid()) return;
+
+	WaitForPendingBatch();
+
+	const int32 comp_index = m_batched_components.Find(component);
+	if (comp_index != INDEX_NONE)
+	{
+		m_batched_components[comp_index] = nullptr;
+
+		// Gathering moved its previous transforms to the end of the path. Walking back, first segment of each line or shape is restored last,
+		// so next test traces from where this one started.
+		for (int32 index = m_batched_segments.Num() - 1; index >= 0; --index)
+		{
+			if (m_batched_segment_owners[index] == comp_index)
+			{
+				component->RestorePreviousTransform(m_batched_segments[index]);
+			}
+		}
+
+		// FinishCollisionTest won't run for it
+		component->ResetCollisionTestResults();
+		component->m_is_previous_trace_complete = true;
+	}
+}
+
+void ATraceAndSweepCollisionManager::FinishPendingBatch()
+{
+	if (!m_pending_batch_task.IsValid()) return;
+
+	LLM_SCOPE_BYTAG(TraceAndSweepCollision);
+	const uint64 start_cycles = FPlatformTime::Cycles64();
+
+	m_pending_batch_task.Wait();
+	m_pending_batch_task = UE::Tasks::FTask();
+
+	if (UWorld* world = GetWorld())
+	{
+		DispatchBatch(world);
+
+		if (m_is_component_collision_pending)
+		{
+			TickComponentCollision();
+		}
+	}
+	m_is_component_collision_pending = false;
+
+	// Waiting and dispatching are on game thread too, so they belong to the tick that launched the batch
+	m_telemetry.AddTickCost(m_pending_tick_seconds + FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - start_cycles));
+	m_pending_tick_seconds = 0.0;
+}
+
+
+void ATraceAndSweepCollisionManager::TickComponentCollision()
+{
+	SCOPE_CYCLE_COUNTER(STAT_TickComponentCollision);
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(TraceAndSweepCollisionManager_TickComponentCollision, TraceAndSweepCollisionChannel);
+
+	m_component_capsule_refs.Reset();
+	m_component_contacts.Reset();
+	m_began_component_contacts.Reset();
+	m_ended_component_pairs.Reset();
+
+	for (int32 slot = 0; slot < m_components.Num(); ++slot)
+	{
+		UTraceAndSweepCollisionComponent* comp = m_components[slot];
+		if (!comp || !comp->m_collide_with_components || !comp->IsTraceCollisionEnabled()) continue;
+
+		comp->UpdateComponentCapsules();
+
+		for (int32 index = 0; index < comp->m_component_capsules.Num(); ++index)
+		{
+			const FCollisionComponentCapsule& start = comp->m_previous_component_capsules[index];
+			const FCollisionComponentCapsule& end = comp->m_component_capsules[index];
+
+			FComponentCapsuleRef& ref = m_component_capsule_refs.AddDefaulted_GetRef();
+			ref.m_slot = slot;
+			ref.m_capsule = index;
+			ref.m_bounds += start.m_point_a;
+			ref.m_bounds += start.m_point_b;
+			ref.m_bounds += end.m_point_a;
+			ref.m_bounds += end.m_point_b;
+			ref.m_bounds = ref.m_bounds.ExpandBy(FMath::Max(start.m_radius, end.m_radius));
+		}
+	}
+
+	SET_DWORD_STAT(STAT_ComponentCollisionCapsules, m_component_capsule_refs.Num());
+
+	if (m_component_capsule_refs.Num() == 0 && m_component_overlap_pairs.Num() == 0) return;
+
+	// Only capsules whose paths share a cell are tested against each other
+	m_component_capsule_grid.Reset(m_swept_volume_cell_size);
+	for (int32 ref_index = 0; ref_index < m_component_capsule_refs.Num(); ++ref_index)
+	{
+		m_component_capsule_grid.Add(ref_index, m_component_capsule_refs[ref_index].m_bounds);
+	}
+	m_component_capsule_grid.Build();
+
+	for (int32 ref_index = 0; ref_index < m_component_capsule_refs.Num(); ++ref_index)
+	{
+		const FComponentCapsuleRef& ref = m_component_capsule_refs[ref_index];
+		const UTraceAndSweepCollisionComponent* comp = m_components[ref.m_slot];
+
+		m_component_capsule_candidates.Reset();
+		m_component_capsule_grid.Query(ref.m_bounds, m_component_capsule_candidates);
+
+		for (const int32 other_index : m_component_capsule_candidates)
+		{
+			// Each pair of capsules once, and never two capsules of same component
+			const FComponentCapsuleRef& other_ref = m_component_capsule_refs[other_index];
+			if (other_index <= ref_index || other_ref.m_slot == ref.m_slot) continue;
+
+			const UTraceAndSweepCollisionComponent* other = m_components[other_ref.m_slot];
+			if (!comp->CanCollideWithComponent(other)) continue;
+
+			TraceAndSweepNarrowPhase::FSweepHit hit;
+			if (!TraceAndSweepNarrowPhase::SweepCapsules(
+				comp->m_previous_component_capsules[ref.m_capsule], comp->m_component_capsules[ref.m_capsule],
+				other->m_previous_component_capsules[other_ref.m_capsule], other->m_component_capsules[other_ref.m_capsule], hit)) continue;
+
+			FComponentContact& contact = m_component_contacts.AddDefaulted_GetRef();
+			contact.m_key = MakeComponentPairKey(ref.m_slot, other_ref.m_slot);
+			contact.m_slot_a = ref.m_slot;
+			contact.m_slot_b = other_ref.m_slot;
+			contact.m_time = hit.m_time;
+			contact.m_location = hit.m_location;
+			contact.m_other_location = hit.m_other_location;
+			contact.m_impact_point = hit.m_impact_point;
+			contact.m_normal = hit.m_normal;
+		}
+	}
+
+	// Keep the earliest contact of every pair
+	m_component_contacts.Sort([](const FComponentContact& a, const FComponentContact& b)
+		{
+			return a.m_key != b.m_key ? a.m_key < b.m_key : a.m_time < b.m_time;
+		});
+	int32 num_pairs = 0;
+	for (int32 index = 0; index < m_component_contacts.Num(); ++index)
+	{
+		if (index == 0 || m_component_contacts[index].m_key != m_component_contacts[index - 1].m_key)
+		{
+			m_component_contacts[num_pairs++] = m_component_contacts[index];
+		}
+	}
+	m_component_contacts.SetNum(num_pairs, EAllowShrinking::No);
+
+	// Both are sorted by key, so pairs that began and ended are found in one pass
+	int32 contact_index = 0;
+	int32 pair_index = 0;
+	while (contact_index < m_component_contacts.Num() || pair_index < m_component_overlap_pairs.Num())
+	{
+		const bool has_contact = contact_index < m_component_contacts.Num();
+		const bool has_pair = pair_index < m_component_overlap_pairs.Num();
+
+		if (has_contact && (!has_pair || m_component_contacts[contact_index].m_key < m_component_overlap_pairs[pair_index]))
+		{
+			m_began_component_contacts.Add(contact_index++);
+		}
+		else if (has_pair && (!has_contact || m_component_overlap_pairs[pair_index] < m_component_contacts[contact_index].m_key))
+		{
+			m_ended_component_pairs.Add(m_component_overlap_pairs[pair_index++]);
+		}
+		else
+		{
+			++contact_index;
+			++pair_index;
+		}
+	}
+
+	// State is updated before the events, since handlers can unregister components
+	m_component_overlap_pairs.Reset();
+	for (const FComponentContact& contact : m_component_contacts)
+	{
+		m_component_overlap_pairs.Add(contact.m_key);
+	}
+
+	for (const uint64 key : m_ended_component_pairs)
+	{
+		const int32 slot_a = int32(key >> 32);
+		const int32 slot_b = int32(uint32(key));
+		BroadcastComponentEndOverlap(slot_a, slot_b);
+		BroadcastComponentEndOverlap(slot_b, slot_a);
+	}
+
+	for (const int32 index : m_began_component_contacts)
+	{
+		const FComponentContact& contact = m_component_contacts[index];
+		BroadcastComponentBeginOverlap(contact.m_slot_a, contact.m_slot_b, contact.m_location, contact.m_impact_point, contact.m_normal, contact.m_time);
+		BroadcastComponentBeginOverlap(contact.m_slot_b, contact.m_slot_a, contact.m_other_location, contact.m_impact_point, -contact.m_normal, contact.m_time);
+	}
+}
+
+void ATraceAndSweepCollisionManager::BroadcastComponentBeginOverlap(int32 slot, int32 other_slot, const FVector& location, const FVector& impact_point, const FVector& normal, float time) const
+{
+	// Event of an earlier pair could have destroyed either of them
+	UTraceAndSweepCollisionComponent* comp = m_components.IsValidIndex(slot) ? m_components[slot] : nullptr;
+	UTraceAndSweepCollisionComponent* other = m_components.IsValidIndex(other_slot) ? m_components[other_slot] : nullptr;
+	if (!IsValid(comp) || !IsValid(other)) return;
+
+	if (FCollisionTelemetryCounters* counters = comp->GetTelemetryCounters())
+	{
+		counters->m_num_begin_overlaps++;
+	}
+
+	FHitResult hit(other->GetOwner(), other, impact_point, normal);
+	hit.bBlockingHit = true;
+	hit.bStartPenetrating = time == 0.0f;
+	hit.Time = time;
+	hit.Location = location;
+	hit.Distance = FVector::Dist(location, impact_point);
+
+	comp->OnComponentBeginOverlap.Broadcast(comp, other->GetOwner(), other, -1, true, hit);
+}
+
+void ATraceAndSweepCollisionManager::BroadcastComponentEndOverlap(int32 slot, int32 other_slot) const
+{
+	UTraceAndSweepCollisionComponent* comp = m_components.IsValidIndex(slot) ? m_components[slot] : nullptr;
+	UTraceAndSweepCollisionComponent* other = m_components.IsValidIndex(other_slot) ? m_components[other_slot] : nullptr;
+	if (!IsValid(comp) || !IsValid(other) || !comp->m_should_generate_end_overlap) return;
+
+	if (FCollisionTelemetryCounters* counters = comp->GetTelemetryCounters())
+	{
+		counters->m_num_end_overlaps++;
+	}
+
+	comp->OnComponentEndOverlap.Broadcast(comp, other->GetOwner(), other, -1);
+}
+
+
+void ATraceAndSweepCollisionManager::OnAsyncTraceComplete(const FTraceHandle& handle, FTraceDatum& data)
+{
+	if (m_async_trace_queue.Push(handle._Handle, data.UserData, data.Start, data.End, data.Rot, data.OutHits))
+	{
+		return;
+	}
+
+	// Queue is full, hand this one over right away. Engine runs trace delegates on game thread, so it is safe to do, only costs the batching.
+	INC_DWORD_STAT(STAT_AsyncTraceQueueOverflow);
+
+	UTraceAndSweepCollisionComponent* comp = m_components.IsValidIndex(data.UserData) ? m_components[data.UserData] : nullptr;
+	if (IsValid(comp))
+	{
+		comp->ReceiveAsyncTraceResult(handle._Handle, data.Start, data.End, data.Rot, data.OutHits);
+	}
+}
+
+void ATraceAndSweepCollisionManager::OnAsyncOverlapComplete(const FTraceHandle& handle, FOverlapDatum& data)
+{
+	// Queue only holds hits, so overlaps become the same zero distance hits a synchronous test adds. Delegates run on game thread, one buffer is enough.
+	m_async_overlap_hits.Reset();
+	UTraceAndSweepCollisionComponent::AppendStartOverlapHits(data.OutOverlaps, data.Pos, data.Pos, m_async_overlap_hits);
+
+	if (m_async_trace_queue.Push(handle._Handle, data.UserData, data.Pos, data.Pos, data.Rot, m_async_overlap_hits))
+	{
+		return;
+	}
+
+	INC_DWORD_STAT(STAT_AsyncTraceQueueOverflow);
+
+	UTraceAndSweepCollisionComponent* comp = m_components.IsValidIndex(data.UserData) ? m_components[data.UserData] : nullptr;
+	if (IsValid(comp))
+	{
+		comp->ReceiveAsyncTraceResult(handle._Handle, data.Pos, data.Pos, data.Rot, m_async_overlap_hits);
+	}
+}
+
+void ATraceAndSweepCollisionManager::DispatchAsyncTraces()
+{
+	SCOPE_CYCLE_COUNTER(STAT_DispatchAsyncTraces);
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(TraceAndSweepCollisionManager_DispatchAsyncTraces, TraceAndSweepCollisionChannel);
+
+	m_async_records.Reset();
+	m_async_trace_queue.Acquire(m_async_records);
+
+	const int32 num_records = m_async_records.Num();
+	SET_DWORD_STAT(STAT_DispatchedAsyncTraces, num_records);
+
+	// Group records by component, stable so each component still sees its traces in the order they completed
+	Algo::StableSort(m_async_records, [](const FCollisionAsyncTraceRecord* a, const FCollisionAsyncTraceRecord* b)
+		{
+			return a->m_route < b->m_route;
+		});
+
+	for (int32 first = 0; first < num_records; )
+	{
+		const uint32 route = m_async_records[first]->m_route;
+
+		int32 last = first + 1;
+		while (last < num_records && m_async_records[last]->m_route == route)
+		{
+			++last;
+		}
+
+		// Component could have been unregistered or destroyed by an overlap event of a previous component
+		UTraceAndSweepCollisionComponent* comp = m_components.IsValidIndex(route) ? m_components[route] : nullptr;
+		if (IsValid(comp))
+		{
+			comp->ReceiveAsyncTraceResults(MakeArrayView(m_async_records).Slice(first, last - first));
+		}
+
+		first = last;
+	}
+
+	m_async_trace_queue.Release(num_records);
 }
 
 
 void ATraceAndSweepCollisionManager::RegisterComponent(UTraceAndSweepCollisionComponent* component)
 {
-	m_components.Add(component);
+	if (component->m_manager_slot != INDEX_NONE) return;
+
+	const int32 slot = m_free_component_slots.Num() > 0 ? m_free_component_slots.Pop(EAllowShrinking::No) : m_components.Add(nullptr);
+	m_components[slot] = component;
+	component->m_manager_slot = slot;
+	component->m_broad_phase = &m_broad_phase;
+
+	component->m_telemetry = &m_telemetry;
+	component->m_telemetry_archetype = m_telemetry.FindOrAddArchetype(component->GetOwner() ? component->GetOwner()->GetClass() : nullptr);
+	component->RefreshTelemetryEventName();
+
+	// Golden ratio sequence, every new phase lands in the largest gap left by the previous ones.
+	// So components spread evenly over their interval however many are spawned together and whatever their interval is.
+	component->m_tick_phase = float(FMath::Frac(m_num_tick_phases++ * 0.6180339887));
+	if (component->m_is_trace_collision_enabled)
+	{
+		component->m_time_elapsed = component->m_tick_phase * component->m_tick_interval;
+	}
+
+	component->m_async_trace_delegate = &m_async_trace_delegate;
+	component->m_async_overlap_delegate = &m_async_overlap_delegate;
+	component->m_async_route = slot;
+
+	// Queue holds capacity * hits per trace hit results, so worlds without asynchronous components don't pay for it.
+	// Nothing has been pushed before the first asynchronous component, so it is safe to init here.
+	if (component->m_execution_type == ECollisionCompExecutionType::ASYNCHRONOUS && !m_async_trace_queue.IsInitialized())
+	{
+		m_async_trace_queue.Init(m_async_trace_queue_capacity, m_async_trace_queue_hits_per_trace);
+	}
+
+	if (m_use_trace_pool)
+	{
+		component->m_trace_pool = &m_trace_pool;
+		component->m_pool_owner = slot;
+		component->RefreshPoolSlots();
+	}
 }
 
 void ATraceAndSweepCollisionManager::UnregisterComponent(UTraceAndSweepCollisionComponent* component)
 {
-	m_components.RemoveSwap(component, false);
+	const int32 slot = component->m_manager_slot;
+	if (!m_components.IsValidIndex(slot) || m_components[slot] != component) return;
+
+	// Component can't go away while a worker thread is tracing it, and it must not get results after it left
+	RemoveFromPendingBatch(component);
+
+	// Owner of a parked component can still be destroyed (Eg: level unload)
+	if (component->m_is_pooled)
+	{
+		for (TPair<TWeakObjectPtr<UClass>, TArray<int32>>& pooled_slots : m_pooled_component_slots)
+		{
+			pooled_slots.Value.RemoveSingleSwap(slot, EAllowShrinking::No);
+		}
+		component->m_is_pooled = false;
+	}
+
+	component->ReleasePoolSlots();
+	component->m_broad_phase = nullptr;
+	component->m_async_trace_delegate = nullptr;
+	component->m_async_overlap_delegate = nullptr;
+
+	// Its traces still in flight are dropped when they arrive
+	m_telemetry.AddAsyncInFlight(-component->m_num_pending_async_traces);
+	component->m_telemetry = nullptr;
+	component->m_telemetry_archetype = INDEX_NONE;
+	component->m_manager_slot = INDEX_NONE;
+
+	// Slot is reused by next registration, which must not inherit the overlaps
+	RemoveComponentOverlapPairs(slot);
+
+	m_components[slot] = nullptr;
+	m_free_component_slots.Add(slot);
+}
+
+void ATraceAndSweepCollisionManager::RemoveComponentOverlapPairs(int32 slot)
+{
+	m_component_overlap_pairs.RemoveAll([slot](uint64 key) { return int32(key >> 32) == slot || int32(uint32(key)) == slot; });
+}
+
+void ATraceAndSweepCollisionManager::RegisterBroadPhaseTarget(UPrimitiveComponent* target)
+{
+	// Batch in flight reads targets from worker threads
+	WaitForPendingBatch();
+	m_broad_phase.AddTarget(target);
 }
 
+void ATraceAndSweepCollisionManager::UnregisterBroadPhaseTarget(UPrimitiveComponent* target)
+{
+	WaitForPendingBatch();
+	m_broad_phase.RemoveTarget(target);
+}
+
+void ATraceAndSweepCollisionManager::ReleaseComponentToPool(UTraceAndSweepCollisionComponent* component)
+{
+	if (!IsValid(component) || component->m_is_pooled || !component->GetOwner()) return;
+
+	const int32 slot = component->m_manager_slot;
+	if (!m_components.IsValidIndex(slot) || m_components[slot] != component) return;
+
+	// Also takes it out of a batch still in flight
+	component->SetIsTraceCollisionEnabled(false);
+	component->m_is_pooled = true;
+	// Otherwise next user of the component gets end overlaps for pairs of the previous one
+	RemoveComponentOverlapPairs(slot);
+	m_pooled_component_slots.FindOrAdd(component->GetOwner()->GetClass()).Add(slot);
+}
+
+UTraceAndSweepCollisionComponent* ATraceAndSweepCollisionManager::AcquirePooledComponent(TSubclassOf<AActor> owner_class, const FTransform& transform)
+{
+	TArray<int32>* pooled_slots = m_pooled_component_slots.Find(owner_class.Get());
+	if (!pooled_slots) return nullptr;
+
+	while (pooled_slots->Num() > 0)
+	{
+		UTraceAndSweepCollisionComponent* component = m_components[pooled_slots->Pop(EAllowShrinking::No)];
+		if (!IsValid(component)) continue;
+
+		component->m_is_pooled = false;
+		component->ResetForReuse(transform);
+		component->SetIsTraceCollisionEnabled(true);
+		return component;
+	}
+
+	return nullptr;
+}
+
+void ATraceAndSweepCollisionManager::QuerySweptVolumes(const FBox& box, TArray<UTraceAndSweepCollisionComponent*>& out_components) const
+{
+	m_swept_volume_query_slots.Reset();
+	m_swept_volume_grid.Query(box, m_swept_volume_query_slots);
+
+	for (const int32 slot : m_swept_volume_query_slots)
+	{
+		// Component could have been unregistered since the grid was built
+		UTraceAndSweepCollisionComponent* comp = m_components.IsValidIndex(slot) ? m_components[slot] : nullptr;
+		if (IsValid(comp))
+		{
+			out_components.Add(comp);
+		}
+	}
+}
@@ -0,0 +1,394 @@
+#include "TraceAndSweepCollisionNarrowPhase.h"
+#include "TraceAndSweepCollisionBroadPhase.h"
+
+
+namespace
+{
+	// Shapes closer than this are touching
+	constexpr float contact_tolerance = 0.01f;
+
+	// Golden ratio conjugate, each step of golden section search keeps this much of the interval
+	constexpr double golden_section = 0.6180339887;
+
+	// Searches never go below this fraction of the motion, well above precision of double time. Interval reaches it in less than 80 golden section steps
+	// or 60 bisection steps, the cap only guards against gaps that aren't convex because of rounding.
+	constexpr double min_time_tolerance = 4.0 * DBL_EPSILON;
+	constexpr int32 max_search_iterations = 128;
+	constexpr int32 max_advance_iterations = 4096;
+
+	bool IsRound(ECollisionCompShapeType shape_type)
+	{
+		return shape_type == ECollisionCompShapeType::SPHERE || shape_type == ECollisionCompShapeType::CAPSULE;
+	}
+
+	bool IsLine(const TraceAndSweepNarrowPhase::FSweptShape& shape)
+	{
+		return shape.m_extent.IsNearlyZero();
+	}
+
+	// Sphere is a capsule whose inner segment has zero length
+	void GetRoundSegment(ECollisionCompShapeType shape_type, const FVector& center, const FQuat& rotation, const FVector& extent, FVector& out_a, FVector& out_b, float& out_radius)
+	{
+		out_radius = extent.X;
+
+		const float inner_half_height = shape_type == ECollisionCompShapeType::CAPSULE ? FMath::Max(0.0f, extent.Z - extent.X) : 0.0f;
+		const FVector inner_offset = rotation.GetAxisZ() * inner_half_height;
+
+		out_a = center - inner_offset;
+		out_b = center + inner_offset;
+	}
+
+	// Gap between two convex shapes, one moving in a straight line relative to the other, is convex over time. So the closest approach is found
+	// with golden section search and first contact with bisection before it, both until time is known to within contact tolerance of motion.
+	// Returns false if gap never gets within contact tolerance.
+	template<typename TGapAtTime>
+	bool FindFirstContactTime(const TGapAtTime& gap_at_time, double motion_length, double& out_time)
+	{
+		out_time = 0.0;
+		if (gap_at_time(0.0) <= contact_tolerance) return true;
+		if (motion_length <= UE_KINDA_SMALL_NUMBER) return false;
+
+		// Time is in double and tolerance is kept above its precision, so intervals always shrink below it
+		const double time_tolerance = FMath::Max(contact_tolerance / motion_length, min_time_tolerance);
+
+		// Closest approach, stops early at first time found that touches
+		double low = 0.0;
+		double high = 1.0;
+		double time_a = high - golden_section * (high - low);
+		double time_b = low + golden_section * (high - low);
+		double gap_a = gap_at_time(time_a);
+		double gap_b = gap_at_time(time_b);
+		double contact_time = -1.0;
+
+		for (int32 iteration = 0; contact_time < 0.0; ++iteration)
+		{
+			if (gap_a <= contact_tolerance)
+			{
+				contact_time = time_a;
+			}
+			else if (gap_b <= contact_tolerance)
+			{
+				contact_time = time_b;
+			}
+			else if (high - low <= time_tolerance || iteration >= max_search_iterations)
+			{
+				// Gap at closest approach is within contact tolerance of the sampled one, so a graze that comes within tolerance isn't missed
+				if (FMath::Min(gap_a, gap_b) > 2.0 * contact_tolerance) return false;
+				contact_time = gap_a < gap_b ? time_a : time_b;
+			}
+			else if (gap_a < gap_b)
+			{
+				high = time_b;
+				time_b = time_a;
+				gap_b = gap_a;
+				time_a = high - golden_section * (high - low);
+				gap_a = gap_at_time(time_a);
+			}
+			else
+			{
+				low = time_a;
+				time_a = time_b;
+				gap_a = gap_b;
+				time_b = low + golden_section * (high - low);
+				gap_b = gap_at_time(time_b);
+			}
+		}
+
+		// Gap only shrinks until closest approach, so it crosses contact tolerance once before contact time
+		low = 0.0;
+		high = contact_time;
+		for (int32 iteration = 0; high - low > time_tolerance && iteration < max_search_iterations; ++iteration)
+		{
+			const double middle = (low + high) * 0.5;
+			if (gap_at_time(middle) <= contact_tolerance)
+			{
+				high = middle;
+			}
+			else
+			{
+				low = middle;
+			}
+		}
+
+		out_time = high;
+		return true;
+	}
+
+	// Conservative advancement, for shapes that rotate or stretch so their gap isn't convex over time. No point of either shape moves more than
+	// max_motion over the whole motion, so the gap can't close faster than that and stepping by gap / max_motion never steps past first contact.
+	// Steps are at least as long as moving by contact tolerance, which can't step past contact either since gap is above it before every step.
+	// Only sliding along within a hair of the other shape for most of a very long motion runs out of iterations, that is taken as a miss.
+	template<typename TGapAtTime>
+	bool AdvanceToFirstContact(const TGapAtTime& gap_at_time, double max_motion, double& out_time)
+	{
+		out_time = 0.0;
+		double gap = gap_at_time(0.0);
+		if (gap <= contact_tolerance) return true;
+		if (max_motion <= UE_KINDA_SMALL_NUMBER) return false;
+
+		const double min_step = FMath::Max(contact_tolerance / max_motion, min_time_tolerance);
+
+		for (int32 iteration = 0; iteration < max_advance_iterations; ++iteration)
+		{
+			// Even closing at full speed for the rest of the motion doesn't touch
+			if (gap - max_motion * (1.0 - out_time) > contact_tolerance) return false;
+
+			out_time = FMath::Min(out_time + FMath::Max(gap / max_motion, min_step), 1.0);
+			gap = gap_at_time(out_time);
+			if (gap <= contact_tolerance) return true;
+		}
+
+		return false;
+	}
+
+	// Sphere and capsule against sphere and capsule. Swept shape only translates, so the gap between the two inner segments is convex over the sweep.
+	bool SweepRound(const TraceAndSweepNarrowPhase::FSweptShape& shape, const FVector& start, const FVector& end, const FCollisionTargetShape& target, TraceAndSweepNarrowPhase::FSweepHit& out_hit)
+	{
+		FVector shape_a, shape_b, target_a, target_b;
+		float shape_radius, target_radius;
+		GetRoundSegment(shape.m_shape_type, FVector::ZeroVector, shape.m_rotation, shape.m_extent, shape_a, shape_b, shape_radius);
+		GetRoundSegment(target.m_shape_type, target.m_center, target.m_rotation, target.m_extent, target_a, target_b, target_radius);
+
+		const FVector delta = end - start;
+		const float combined_radius = shape_radius + target_radius;
+
+		auto get_closest_points = [&](double time, FVector& out_on_shape, FVector& out_on_target)
+			{
+				const FVector location = start + delta * time;
+				FMath::SegmentDistToSegmentSafe(location + shape_a, location + shape_b, target_a, target_b, out_on_shape, out_on_target);
+			};
+
+		auto gap_at_time = [&](double time)
+			{
+				FVector closest_on_shape, closest_on_target;
+				get_closest_points(time, closest_on_shape, closest_on_target);
+				return FVector::Dist(closest_on_shape, closest_on_target) - combined_radius;
+			};
+
+		double time = 0.0;
+		if (!FindFirstContactTime(gap_at_time, delta.Size(), time)) return false;
+
+		FVector closest_on_shape, closest_on_target;
+		get_closest_points(time, closest_on_shape, closest_on_target);
+		const float distance = FVector::Dist(closest_on_shape, closest_on_target);
+
+		// Segments crossing each other have no direction between them, push back along the sweep instead
+		const FVector normal = distance > UE_KINDA_SMALL_NUMBER ? (closest_on_shape - closest_on_target) / distance : -delta.GetSafeNormal();
+
+		out_hit.m_time = float(time);
+		out_hit.m_location = start + delta * time;
+		out_hit.m_normal = normal;
+		out_hit.m_impact_point = closest_on_target + normal * target_radius;
+		out_hit.m_is_start_penetrating = time == 0.0 && distance < combined_radius;
+		return true;
+	}
+
+	// Box against box with separating axis test on a moving box. For every axis the time interval in which the projections overlap
+	// is found, the boxes touch where all intervals overlap and the first contact is at the latest entry time.
+	bool SweepBox(const TraceAndSweepNarrowPhase::FSweptShape& shape, const FVector& start, const FVector& end, const FCollisionTargetShape& target, TraceAndSweepNarrowPhase::FSweepHit& out_hit)
+	{
+		const FVector shape_axes[3] = { shape.m_rotation.GetAxisX(), shape.m_rotation.GetAxisY(), shape.m_rotation.GetAxisZ() };
+		const FVector target_axes[3] = { target.m_rotation.GetAxisX(), target.m_rotation.GetAxisY(), target.m_rotation.GetAxisZ() };
+
+		// Line is a box with zero extent, its own rotation doesn't matter
+		const FVector shape_extent = shape.m_shape_type == ECollisionCompShapeType::BOX ? shape.m_extent : FVector::ZeroVector;
+
+		const FVector delta = end - start;
+		const FVector to_target = target.m_center - start;
+
+		float entry_time = -UE_BIG_NUMBER;
+		float exit_time = UE_BIG_NUMBER;
+		FVector entry_axis = -delta.GetSafeNormal();
+		float entry_separation = 0.0f;
+
+		auto test_axis = [&](FVector axis) -> bool
+		{
+			const float length_squared = axis.SizeSquared();
+			// Cross product of parallel axis, already covered by the face axis
+			if (length_squared < UE_KINDA_SMALL_NUMBER) return true;
+			axis *= FMath::InvSqrt(length_squared);
+
+			const float shape_projection =
+				shape_extent.X * FMath::Abs(FVector::DotProduct(shape_axes[0], axis)) +
+				shape_extent.Y * FMath::Abs(FVector::DotProduct(shape_axes[1], axis)) +
+				shape_extent.Z * FMath::Abs(FVector::DotProduct(shape_axes[2], axis));
+			const float target_projection =
+				target.m_extent.X * FMath::Abs(FVector::DotProduct(target_axes[0], axis)) +
+				target.m_extent.Y * FMath::Abs(FVector::DotProduct(target_axes[1], axis)) +
+				target.m_extent.Z * FMath::Abs(FVector::DotProduct(target_axes[2], axis));
+			const float combined_projection = shape_projection + target_projection;
+
+			// Separation along axis at time t is separation - t * speed
+			const float separation = FVector::DotProduct(to_target, axis);
+			const float speed = FVector::DotProduct(delta, axis);
+
+			if (FMath::Abs(speed) <= UE_KINDA_SMALL_NUMBER)
+			{
+				// Not moving along this axis, either always overlapping on it or never
+				return FMath::Abs(separation) <= combined_projection;
+			}
+
+			const float time_a = (separation - combined_projection) / speed;
+			const float time_b = (separation + combined_projection) / speed;
+			const float axis_entry = FMath::Min(time_a, time_b);
+			const float axis_exit = FMath::Max(time_a, time_b);
+
+			if (axis_entry > entry_time)
+			{
+				entry_time = axis_entry;
+				entry_axis = axis;
+				entry_separation = separation - axis_entry * speed;
+			}
+			exit_time = FMath::Min(exit_time, axis_exit);
+
+			return entry_time <= exit_time;
+		};
+
+		for (int32 i = 0; i < 3; ++i)
+		{
+			if (!test_axis(shape_axes[i]) || !test_axis(target_axes[i])) return false;
+		}
+
+		for (int32 i = 0; i < 3; ++i)
+		{
+			for (int32 j = 0; j < 3; ++j)
+			{
+				if (!test_axis(FVector::CrossProduct(shape_axes[i], target_axes[j]))) return false;
+			}
+		}
+
+		if (entry_time > 1.0f || exit_time < 0.0f) return false;
+
+		const bool is_start_penetrating = entry_time <= 0.0f;
+		const float time = FMath::Max(0.0f, entry_time);
+
+		// Target is on positive side of the axis if separation is positive, normal has to point away from it
+		const FVector normal = entry_separation > 0.0f ? -entry_axis : entry_axis;
+		const FVector location = start + delta * time;
+
+		// Closest corner of swept box in direction of the target
+		FVector impact_point = location;
+		for (int32 i = 0; i < 3; ++i)
+		{
+			impact_point -= shape_axes[i] * (shape_extent[i] * FMath::Sign(FVector::DotProduct(shape_axes[i], normal)));
+		}
+
+		out_hit.m_time = time;
+		out_hit.m_location = location;
+		out_hit.m_normal = normal;
+		out_hit.m_impact_point = impact_point;
+		out_hit.m_is_start_penetrating = is_start_penetrating;
+		return true;
+	}
+}
+
+
+bool TraceAndSweepNarrowPhase::IsPairSupported(const FSweptShape& shape, const FCollisionTargetShape& target)
+{
+	if (!target.m_is_simple_shape) return false;
+
+	if (IsLine(shape)) return true;
+
+	if (IsRound(shape.m_shape_type))
+	{
+		return IsRound(target.m_shape_type);
+	}
+
+	return shape.m_shape_type == ECollisionCompShapeType::BOX && target.m_shape_type == ECollisionCompShapeType::BOX;
+}
+
+bool TraceAndSweepNarrowPhase::Sweep(const FSweptShape& shape, const FVector& start, const FVector& end, const FCollisionTargetShape& target, FSweepHit& out_hit)
+{
+	if (IsRound(target.m_shape_type))
+	{
+		return SweepRound(shape, start, end, target, out_hit);
+	}
+
+	return SweepBox(shape, start, end, target, out_hit);
+}
+
+bool TraceAndSweepNarrowPhase::SweepCapsules(const FCollisionComponentCapsule& a_start, const FCollisionComponentCapsule& a_end, const FCollisionComponentCapsule& b_start, const FCollisionComponentCapsule& b_end, FSweepHit& out_hit)
+{
+	const float touch_distance = FMath::Max(a_start.m_radius, a_end.m_radius) + FMath::Max(b_start.m_radius, b_end.m_radius);
+
+	auto fill_hit = [&](double time, const FVector& point_on_a, const FVector& point_on_b)
+		{
+			const FVector normal = (point_on_a - point_on_b).GetSafeNormal();
+			out_hit.m_time = float(time);
+			out_hit.m_normal = normal;
+			// Centers at time of impact, same as location of every other sweep
+			out_hit.m_location = (FMath::Lerp(a_start.m_point_a, a_end.m_point_a, time) + FMath::Lerp(a_start.m_point_b, a_end.m_point_b, time)) * 0.5;
+			out_hit.m_other_location = (FMath::Lerp(b_start.m_point_a, b_end.m_point_a, time) + FMath::Lerp(b_start.m_point_b, b_end.m_point_b, time)) * 0.5;
+			out_hit.m_impact_point = point_on_b + normal * FMath::Max(b_start.m_radius, b_end.m_radius);
+			out_hit.m_is_start_penetrating = time == 0.0;
+		};
+
+	const bool is_a_sphere = a_start.m_point_a.Equals(a_start.m_point_b) && a_end.m_point_a.Equals(a_end.m_point_b);
+	const bool is_b_sphere = b_start.m_point_a.Equals(b_start.m_point_b) && b_end.m_point_a.Equals(b_end.m_point_b);
+
+	if (is_a_sphere && is_b_sphere)
+	{
+		// Closest approach of the relative motion
+		const FVector offset = a_start.m_point_a - b_start.m_point_a;
+		const FVector velocity = (a_end.m_point_a - a_start.m_point_a) - (b_end.m_point_a - b_start.m_point_a);
+		const double speed_squared = velocity.SizeSquared();
+		const double touch_squared = FMath::Square(touch_distance);
+
+		double time = 0.0;
+		if (offset.SizeSquared() > touch_squared)
+		{
+			if (speed_squared < UE_SMALL_NUMBER) return false;
+
+			// First root of |offset + velocity * t| = touch_distance
+			const double b = FVector::DotProduct(offset, velocity);
+			const double c = offset.SizeSquared() - touch_squared;
+			const double discriminant = b * b - speed_squared * c;
+			if (b >= 0.0 || discriminant < 0.0) return false;
+
+			time = (-b - FMath::Sqrt(discriminant)) / speed_squared;
+			if (time > 1.0) return false;
+		}
+
+		fill_hit(time, FMath::Lerp(a_start.m_point_a, a_end.m_point_a, time), FMath::Lerp(b_start.m_point_a, b_end.m_point_a, time));
+		return true;
+	}
+
+	auto get_closest_points = [&](double time, FVector& out_on_a, FVector& out_on_b)
+		{
+			FMath::SegmentDistToSegmentSafe(
+				FMath::Lerp(a_start.m_point_a, a_end.m_point_a, time), FMath::Lerp(a_start.m_point_b, a_end.m_point_b, time),
+				FMath::Lerp(b_start.m_point_a, b_end.m_point_a, time), FMath::Lerp(b_start.m_point_b, b_end.m_point_b, time),
+				out_on_a, out_on_b);
+		};
+
+	auto gap_at_time = [&](double time)
+		{
+			FVector point_on_a, point_on_b;
+			get_closest_points(time, point_on_a, point_on_b);
+			return FVector::Dist(point_on_a, point_on_b) - touch_distance;
+		};
+
+	double time = 0.0;
+
+	// Neither capsule rotates or stretches, so one moves in a straight line relative to the other and their gap is convex over time
+	const bool is_translating = (a_start.m_point_b - a_start.m_point_a).Equals(a_end.m_point_b - a_end.m_point_a)
+		&& (b_start.m_point_b - b_start.m_point_a).Equals(b_end.m_point_b - b_end.m_point_a);
+
+	if (is_translating)
+	{
+		const FVector relative_delta = (a_end.m_point_a - a_start.m_point_a) - (b_end.m_point_a - b_start.m_point_a);
+		if (!FindFirstContactTime(gap_at_time, relative_delta.Size(), time)) return false;
+	}
+	else
+	{
+		// Every point of a capsule's segment moves in a straight line at a speed in between the speeds of its end points
+		const double max_motion = FMath::Max(FVector::Dist(a_start.m_point_a, a_end.m_point_a), FVector::Dist(a_start.m_point_b, a_end.m_point_b))
+			+ FMath::Max(FVector::Dist(b_start.m_point_a, b_end.m_point_a), FVector::Dist(b_start.m_point_b, b_end.m_point_b));
+		if (!AdvanceToFirstContact(gap_at_time, max_motion, time)) return false;
+	}
+
+	FVector point_on_a, point_on_b;
+	get_closest_points(time, point_on_a, point_on_b);
+	fill_hit(time, point_on_a, point_on_b);
+	return true;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "TraceAndSweepCollisionTypes.h"
+
+struct FCollisionTargetShape;
+
+
+// Analytic time of impact between a swept primitive and a static broad phase target.
+// Only reads the given shapes, so it never touches the physics scene and can be called from any thread.
+namespace TraceAndSweepNarrowPhase
+{
+	// Shape being swept. Lines are spheres with zero extent.
+	struct FSweptShape
+	{
+		ECollisionCompShapeType m_shape_type = ECollisionCompShapeType::SPHERE;
+		FQuat m_rotation = FQuat::Identity;
+
+		// Box half extent, (radius, radius, half height) for capsule and radius on all axis for sphere
+		FVector m_extent = FVector::ZeroVector;
+	};
+
+	struct FSweepHit
+	{
+		// Fraction of start to end at which the shapes first touch
+		float m_time = 1.0f;
+		// Location of swept shape at time of impact
+		FVector m_location = FVector::ZeroVector;
+		// Location of the other shape at time of impact, only set by SweepCapsules since targets don't move
+		FVector m_other_location = FVector::ZeroVector;
+		FVector m_impact_point = FVector::ZeroVector;
+		// Points away from the target
+		FVector m_normal = FVector::ZeroVector;
+		bool m_is_start_penetrating = false;
+	};
+
+	// Sphere and capsule pairs with each other, box pairs with box. Lines (zero extent sphere) pair with all three.
+	bool IsPairSupported(const FSweptShape& shape, const FCollisionTargetShape& target);
+
+	// Returns true if shape moving from start to end touches the target and fills time of impact.
+	// Pair must be supported, see IsPairSupported.
+	bool Sweep(const FSweptShape& shape, const FVector& start, const FVector& end, const FCollisionTargetShape& target, FSweepHit& out_hit);
+
+	// Two capsules that both move from start to end over the same time. Returns true if they come within touching distance, with the first time they do.
+	// Normal points from b to a. Exact for two spheres, other pairs find first contact to within contact tolerance however far they move,
+	// in a bounded number of steps.
+	bool SweepCapsules(const FCollisionComponentCapsule& a_start, const FCollisionComponentCapsule& a_end, const FCollisionComponentCapsule& b_start, const FCollisionComponentCapsule& b_end, FSweepHit& out_hit);
+}
@@ -0,0 +1,51 @@
+#include "TraceAndSweepCollisionSubsystem.h"
+#include "TraceAndSweepCollisionManager.h"
+
+#include "Engine/World.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogTraceAndSweepCollisionSubsystem, Log, All);
+
+
+ATraceAndSweepCollisionManager* UTraceAndSweepCollisionSubsystem::GetManager()
+{
+	if (IsValid(m_manager)) return m_manager;
+
+	UWorld* world = GetWorld();
+	if (!world || world->bIsTearingDown) return nullptr;
+
+	// Nothing placed in the level, spawned manager registers itself in PostInitializeComponents
+	FActorSpawnParameters spawn_params;
+	spawn_params.ObjectFlags |= RF_Transient;
+	world->SpawnActor<ATraceAndSweepCollisionManager>(spawn_params);
+
+	return m_manager;
+}
+
+ATraceAndSweepCollisionManager* UTraceAndSweepCollisionSubsystem::FindManager() const
+{
+	return IsValid(m_manager) ? m_manager : nullptr;
+}
+
+void UTraceAndSweepCollisionSubsystem::SetManager(ATraceAndSweepCollisionManager* manager)
+{
+	if (IsValid(m_manager) && m_manager != manager)
+	{
+		UE_LOG(LogTraceAndSweepCollisionSubsystem, Warning, TEXT("%s is ignored, %s is already the manager of this world"), *GetNameSafe(manager), *GetNameSafe(m_manager));
+		return;
+	}
+
+	m_manager = manager;
+}
+
+void UTraceAndSweepCollisionSubsystem::ClearManager(ATraceAndSweepCollisionManager* manager)
+{
+	if (m_manager == manager)
+	{
+		m_manager = nullptr;
+	}
+}
+
+bool UTraceAndSweepCollisionSubsystem::DoesSupportWorldType(const EWorldType::Type world_type) const
+{
+	return world_type == EWorldType::Game || world_type == EWorldType::PIE;
+}
@@ -0,0 +1,133 @@
+#include "TraceAndSweepCollisionSweptVolumeGrid.h"
+
+#include "Algo/BinarySearch.h"
+
+
+void FCollisionSweptVolumeGrid::Reset(float cell_size)
+{
+	m_cell_size = FMath::Max(cell_size, 1.0f);
+
+	m_volumes.Reset();
+	m_owners.Reset();
+	m_cell_entries.Reset();
+	m_large_volumes.Reset();
+}
+
+void FCollisionSweptVolumeGrid::Add(int32 owner, const FBox& swept_bounds)
+{
+	if (!swept_bounds.IsValid) return;
+
+	const int32 volume = m_volumes.Add(swept_bounds);
+	m_owners.Add(owner);
+
+	const FIntVector min_cell = GetCell(swept_bounds.Min);
+	const FIntVector max_cell = GetCell(swept_bounds.Max);
+	const FIntVector num_cells = max_cell - min_cell + FIntVector(1);
+
+	if (int64(num_cells.X) * num_cells.Y * num_cells.Z > max_cells_per_volume)
+	{
+		m_large_volumes.Add(volume);
+		return;
+	}
+
+	for (int32 x = min_cell.X; x <= max_cell.X; ++x)
+	{
+		for (int32 y = min_cell.Y; y <= max_cell.Y; ++y)
+		{
+			for (int32 z = min_cell.Z; z <= max_cell.Z; ++z)
+			{
+				m_cell_entries.Add({ MakeCellKey(x, y, z), volume });
+			}
+		}
+	}
+}
+
+void FCollisionSweptVolumeGrid::Build()
+{
+	m_cell_entries.Sort([](const FCellEntry& a, const FCellEntry& b)
+		{
+			return a.m_cell_key != b.m_cell_key ? a.m_cell_key < b.m_cell_key : a.m_volume < b.m_volume;
+		});
+}
+
+void FCollisionSweptVolumeGrid::Query(const FBox& box, TArray<int32>& out_owners) const
+{
+	if (!box.IsValid || m_volumes.Num() == 0) return;
+
+	const int32 first_owner = out_owners.Num();
+
+	for (const int32 volume : m_large_volumes)
+	{
+		if (m_volumes[volume].Intersect(box))
+		{
+			out_owners.Add(m_owners[volume]);
+		}
+	}
+
+	const FIntVector min_cell = GetCell(box.Min);
+	const FIntVector max_cell = GetCell(box.Max);
+	const FIntVector num_cells = max_cell - min_cell + FIntVector(1);
+
+	if (int64(num_cells.X) * num_cells.Y * num_cells.Z > m_cell_entries.Num())
+	{
+		// Query covers more cells than there are entries, going through the volumes is cheaper
+		for (int32 volume = 0; volume < m_volumes.Num(); ++volume)
+		{
+			if (m_volumes[volume].Intersect(box))
+			{
+				out_owners.Add(m_owners[volume]);
+			}
+		}
+	}
+	else
+	{
+		for (int32 x = min_cell.X; x <= max_cell.X; ++x)
+		{
+			for (int32 y = min_cell.Y; y <= max_cell.Y; ++y)
+			{
+				for (int32 z = min_cell.Z; z <= max_cell.Z; ++z)
+				{
+					const uint64 cell_key = MakeCellKey(x, y, z);
+					int32 index = Algo::LowerBoundBy(m_cell_entries, cell_key, &FCellEntry::m_cell_key);
+
+					for (; index < m_cell_entries.Num() && m_cell_entries[index].m_cell_key == cell_key; ++index)
+					{
+						const int32 volume = m_cell_entries[index].m_volume;
+						if (m_volumes[volume].Intersect(box))
+						{
+							out_owners.Add(m_owners[volume]);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// Volume spanning several cells is found once per cell
+	TArrayView<int32> new_owners = MakeArrayView(out_owners).RightChop(first_owner);
+	new_owners.Sort();
+	int32 num_unique = 0;
+	for (int32 index = 0; index < new_owners.Num(); ++index)
+	{
+		if (index == 0 || new_owners[index] != new_owners[index - 1])
+		{
+			new_owners[num_unique++] = new_owners[index];
+		}
+	}
+	out_owners.SetNum(first_owner + num_unique, EAllowShrinking::No);
+}
+
+FIntVector FCollisionSweptVolumeGrid::GetCell(const FVector& location) const
+{
+	return FIntVector(
+		FMath::FloorToInt32(location.X / m_cell_size),
+		FMath::FloorToInt32(location.Y / m_cell_size),
+		FMath::FloorToInt32(location.Z / m_cell_size));
+}
+
+// 21 bits per axis, cells far enough apart to wrap onto the same key are told apart by the box test
+uint64 FCollisionSweptVolumeGrid::MakeCellKey(int32 x, int32 y, int32 z)
+{
+	constexpr uint64 mask = (uint64(1) << 21) - 1;
+	return ((uint64(x) & mask) << 42) | ((uint64(y) & mask) << 21) | (uint64(z) & mask);
+}
@@ -0,0 +1,214 @@
+#include "TraceAndSweepCollisionTelemetry.h"
+#include "TraceAndSweepCollisionManager.h"
+#include "TraceAndSweepCollisionSubsystem.h"
+
+#include "HAL/IConsoleManager.h"
+#include "Engine/World.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+UE_TRACE_CHANNEL_DEFINE(TraceAndSweepCollisionChannel);
+
+
+FCollisionTelemetryHistogram::FCollisionTelemetryHistogram()
+{
+	Reset();
+}
+
+void FCollisionTelemetryHistogram::Add(double value)
+{
+	// Bucket n holds values up to first_bucket_bound * bucket_ratio^n
+	int32 bucket = 0;
+	if (value > first_bucket_bound)
+	{
+		bucket = FMath::Min(FMath::CeilToInt32(FMath::Loge(value / first_bucket_bound) / FMath::Loge(bucket_ratio)), num_buckets - 1);
+	}
+
+	m_counts[bucket]++;
+	m_num_values++;
+	m_sum += value;
+	m_max_value = FMath::Max(m_max_value, value);
+}
+
+void FCollisionTelemetryHistogram::Reset()
+{
+	FMemory::Memzero(m_counts);
+	m_num_values = 0;
+	m_sum = 0.0;
+	m_max_value = 0.0;
+}
+
+double FCollisionTelemetryHistogram::GetPercentile(double percentile) const
+{
+	if (m_num_values == 0) return 0.0;
+
+	const int64 rank = FMath::Max<int64>(1, FMath::CeilToInt64(FMath::Clamp(percentile, 0.0, 100.0) * 0.01 * m_num_values));
+
+	int64 num_below = 0;
+	for (int32 bucket = 0; bucket < num_buckets; ++bucket)
+	{
+		num_below += m_counts[bucket];
+		if (num_below >= rank)
+		{
+			// Bound of last bucket or of a sparse top bucket can be far above anything that was added
+			return FMath::Min(first_bucket_bound * FMath::Pow(bucket_ratio, double(bucket)), m_max_value);
+		}
+	}
+
+	return m_max_value;
+}
+
+
+int32 FCollisionTelemetry::FindOrAddArchetype(const UClass* owner_class)
+{
+	// Path name, since Blueprint classes in different folders can have the same short name
+	const FName archetype = owner_class ? FName(*owner_class->GetPathName()) : NAME_None;
+	if (const int32* index = m_archetype_indices.Find(archetype))
+	{
+		return *index;
+	}
+
+	const int32 index = m_archetypes.AddDefaulted();
+	m_archetypes[index].m_archetype = archetype;
+	m_archetype_indices.Add(archetype, index);
+	return index;
+}
+
+void FCollisionTelemetry::AddTickCost(double seconds)
+{
+	m_tick_cost_us.Add(seconds * 1.0e6);
+}
+
+void FCollisionTelemetry::AddAsyncLatency(double seconds)
+{
+	m_async_latency_ms.Add(seconds * 1.0e3);
+}
+
+void FCollisionTelemetry::Reset()
+{
+	for (FCollisionTelemetryCounters& counters : m_archetypes)
+	{
+		counters = FCollisionTelemetryCounters{ counters.m_archetype };
+	}
+
+	m_tick_cost_us.Reset();
+	m_async_latency_ms.Reset();
+
+	// Traces in flight are still coming back, only the peak starts over
+	m_max_async_in_flight = m_num_async_in_flight;
+	m_reset_seconds = FPlatformTime::Seconds();
+}
+
+void FCollisionTelemetry::Dump(FOutputDevice& ar) const
+{
+	auto dump_histogram = [&ar](const TCHAR* name, const FCollisionTelemetryHistogram& histogram)
+	{
+		ar.Logf(TEXT("%s: count %lld, mean %.2f, p50 %.2f, p90 %.2f, p99 %.2f, max %.2f"), name, histogram.Num(), histogram.GetMean(),
+			histogram.GetPercentile(50.0), histogram.GetPercentile(90.0), histogram.GetPercentile(99.0), histogram.GetMax());
+	};
+
+	ar.Logf(TEXT("TraceAndSweepCollision telemetry of last %.1f s"), FPlatformTime::Seconds() - m_reset_seconds);
+	dump_histogram(TEXT("Manager tick (us)"), m_tick_cost_us);
+	dump_histogram(TEXT("Async trace latency (ms)"), m_async_latency_ms);
+	ar.Logf(TEXT("Async traces in flight: %d, max %d"), m_num_async_in_flight, m_max_async_in_flight);
+
+	TArray<const FCollisionTelemetryCounters*> sorted;
+	for (const FCollisionTelemetryCounters& counters : m_archetypes)
+	{
+		sorted.Add(&counters);
+	}
+	sorted.Sort([](const FCollisionTelemetryCounters& a, const FCollisionTelemetryCounters& b) { return a.m_seconds > b.m_seconds; });
+
+	ar.Logf(TEXT("archetype,collision_tests,traces,hits,begin_overlaps,end_overlaps,ms,us_per_test"));
+	for (const FCollisionTelemetryCounters* counters : sorted)
+	{
+		ar.Logf(TEXT("%s,%lld,%lld,%lld,%lld,%lld,%.3f,%.2f"), *counters->m_archetype.ToString(), counters->m_num_collision_tests, counters->m_num_traces,
+			counters->m_num_hits, counters->m_num_begin_overlaps, counters->m_num_end_overlaps, counters->m_seconds * 1.0e3,
+			counters->m_num_collision_tests > 0 ? counters->m_seconds * 1.0e6 / counters->m_num_collision_tests : 0.0);
+	}
+}
+
+bool FCollisionTelemetry::WriteCsv(const FString& path) const
+{
+	TArray<FString> rows;
+	rows.Add(TEXT("metric,name,value"));
+	rows.Add(FString::Printf(TEXT("seconds,,%.3f"), FPlatformTime::Seconds() - m_reset_seconds));
+
+	auto add_histogram = [&rows](const TCHAR* metric, const FCollisionTelemetryHistogram& histogram)
+	{
+		rows.Add(FString::Printf(TEXT("%s,count,%lld"), metric, histogram.Num()));
+		rows.Add(FString::Printf(TEXT("%s,mean,%.3f"), metric, histogram.GetMean()));
+		rows.Add(FString::Printf(TEXT("%s,p50,%.3f"), metric, histogram.GetPercentile(50.0)));
+		rows.Add(FString::Printf(TEXT("%s,p90,%.3f"), metric, histogram.GetPercentile(90.0)));
+		rows.Add(FString::Printf(TEXT("%s,p99,%.3f"), metric, histogram.GetPercentile(99.0)));
+		rows.Add(FString::Printf(TEXT("%s,max,%.3f"), metric, histogram.GetMax()));
+	};
+
+	add_histogram(TEXT("tick_us"), m_tick_cost_us);
+	add_histogram(TEXT("async_latency_ms"), m_async_latency_ms);
+	rows.Add(FString::Printf(TEXT("async_in_flight,current,%d"), m_num_async_in_flight));
+	rows.Add(FString::Printf(TEXT("async_in_flight,max,%d"), m_max_async_in_flight));
+
+	for (const FCollisionTelemetryCounters& counters : m_archetypes)
+	{
+		const FString name = counters.m_archetype.ToString();
+		rows.Add(FString::Printf(TEXT("collision_tests,%s,%lld"), *name, counters.m_num_collision_tests));
+		rows.Add(FString::Printf(TEXT("traces,%s,%lld"), *name, counters.m_num_traces));
+		rows.Add(FString::Printf(TEXT("hits,%s,%lld"), *name, counters.m_num_hits));
+		rows.Add(FString::Printf(TEXT("begin_overlaps,%s,%lld"), *name, counters.m_num_begin_overlaps));
+		rows.Add(FString::Printf(TEXT("end_overlaps,%s,%lld"), *name, counters.m_num_end_overlaps));
+		rows.Add(FString::Printf(TEXT("ms,%s,%.3f"), *name, counters.m_seconds * 1.0e3));
+	}
+
+	return FFileHelper::SaveStringArrayToFile(rows, *path);
+}
+
+
+namespace
+{
+	// TraceAndSweepCollision.Telemetry [reset | csv [path]]
+	void Telemetry(const TArray<FString>& args, UWorld* world, FOutputDevice& ar)
+	{
+		UTraceAndSweepCollisionSubsystem* subsystem = world ? world->GetSubsystem<UTraceAndSweepCollisionSubsystem>() : nullptr;
+		// Only reports on a manager that is already there, looking at telemetry shouldn't spawn one
+		ATraceAndSweepCollisionManager* manager = subsystem ? subsystem->FindManager() : nullptr;
+		if (!manager)
+		{
+			ar.Log(TEXT("No TraceAndSweepCollision manager in this world"));
+			return;
+		}
+
+		FCollisionTelemetry& telemetry = manager->GetTelemetry();
+
+		if (args.Num() > 0 && args[0] == TEXT("reset"))
+		{
+			telemetry.Reset();
+			ar.Log(TEXT("TraceAndSweepCollision telemetry reset"));
+		}
+		else if (args.Num() > 0 && args[0] == TEXT("csv"))
+		{
+			const FString csv_path = args.Num() > 1
+				? args[1]
+				: FPaths::ProfilingDir() / TEXT("TraceAndSweepCollision") / FString::Printf(TEXT("Telemetry-%s.csv"), *FDateTime::Now().ToString());
+
+			if (telemetry.WriteCsv(csv_path))
+			{
+				ar.Logf(TEXT("TraceAndSweepCollision telemetry written to %s"), *csv_path);
+			}
+			else
+			{
+				ar.Logf(TEXT("Failed to write TraceAndSweepCollision telemetry to %s"), *csv_path);
+			}
+		}
+		else
+		{
+			telemetry.Dump(ar);
+		}
+	}
+
+	static FAutoConsoleCommandWithWorldArgsAndOutputDevice TelemetryCommand(
+		TEXT("TraceAndSweepCollision.Telemetry"),
+		TEXT("Prints tick cost and async latency percentiles and counters per owner class since last reset. Usage: TraceAndSweepCollision.Telemetry [reset | csv [path]]"),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&Telemetry));
+}
@@ -1 +1,390 @@
 #include "TraceAndSweepCollisionTypes.h"
+
+#include "GameFramework/Actor.h"
+#include "Components/PrimitiveComponent.h"
+
+
+FCollisionHitKey::FCollisionHitKey(const FHitResult& result) :
+	m_actor(result.GetActor()),
+	m_component(result.GetComponent()),
+	m_item(result.Item)
+{}
+
+
+FCollisionHitRecord::FCollisionHitRecord(const FHitResult& result) :
+	m_component(result.GetComponent()),
+	m_item(result.Item),
+	m_distance(result.Distance),
+	m_impact_point(result.ImpactPoint),
+	m_impact_normal(result.ImpactNormal)
+{}
+
+FHitResult FCollisionHitRecord::MakeHitResult() const
+{
+	UPrimitiveComponent* component = m_component.Get();
+
+	FHitResult result(component ? component->GetOwner() : nullptr, component, m_impact_point, m_impact_normal);
+	result.bBlockingHit = true;
+	result.Item = m_item;
+	result.Distance = m_distance;
+	result.ImpactPoint = m_impact_point;
+	result.ImpactNormal = m_impact_normal;
+	return result;
+}
+
+
+FCollisionHitEntry& FCollisionHitSet::FindOrAdd(const FHitResult& result, bool& out_is_new)
+{
+	const FCollisionHitKey key(result);
+
+	// Record is only built for hits that aren't in the set yet
+	const int32* index_ptr = m_indices.Find(key);
+	if (index_ptr)
+	{
+		out_is_new = false;
+		return m_entries[*index_ptr];
+	}
+
+	return FindOrAdd(key, FCollisionHitRecord(result), out_is_new);
+}
+
+FCollisionHitEntry& FCollisionHitSet::FindOrAdd(const FCollisionHitKey& key, const FCollisionHitRecord& record, bool& out_is_new)
+{
+	const int32* index_ptr = m_indices.Find(key);
+	if (index_ptr)
+	{
+		out_is_new = false;
+		return m_entries[*index_ptr];
+	}
+
+	out_is_new = true;
+	const int32 index = m_entries.AddDefaulted();
+	m_indices.Add(key, index);
+
+	FCollisionHitEntry& entry = m_entries[index];
+	entry.m_key = key;
+	entry.m_record = record;
+	return entry;
+}
+
+bool FCollisionHitSet::AddUnique(const FHitResult& result)
+{
+	bool is_new = false;
+	FindOrAdd(result, is_new);
+	return is_new;
+}
+
+FCollisionHitEntry* FCollisionHitSet::Find(const FCollisionHitKey& key)
+{
+	const int32* index_ptr = m_indices.Find(key);
+	return index_ptr ? &m_entries[*index_ptr] : nullptr;
+}
+
+bool FCollisionHitSet::Release(const FCollisionHitKey& key)
+{
+	const int32* index_ptr = m_indices.Find(key);
+	if (!index_ptr) return false;
+
+	const int32 index = *index_ptr;
+	m_entries[index].m_count--;
+	if (m_entries[index].m_count <= 0)
+	{
+		RemoveAt(index);
+		return true;
+	}
+
+	return false;
+}
+
+void FCollisionHitSet::Remove(const FCollisionHitKey& key)
+{
+	const int32* index_ptr = m_indices.Find(key);
+	if (index_ptr)
+	{
+		RemoveAt(*index_ptr);
+	}
+}
+
+void FCollisionHitSet::Reset()
+{
+	m_entries.Reset();
+	m_indices.Reset();
+}
+
+void FCollisionHitSet::RemoveAt(int32 index)
+{
+	m_indices.Remove(m_entries[index].m_key);
+	m_entries.RemoveAtSwap(index, 1, EAllowShrinking::No);
+
+	// Last entry was moved into the removed slot, so point its key to the new index
+	if (index < m_entries.Num())
+	{
+		m_indices[m_entries[index].m_key] = index;
+	}
+}
+
+
+void FCollisionSubStepSettings::AppendSegments(const FCollisionTraceSegment& segment, TArray<FCollisionTraceSegment>& out_segments) const
+{
+	if (!IsEnabled())
+	{
+		out_segments.Add(segment);
+		return;
+	}
+
+	// Rotation from start to end in world space, shortest way around
+	FQuat delta_rotation = segment.m_end_rotation * segment.m_start_rotation.Inverse();
+	delta_rotation.EnforceShortestArcWith(FQuat::Identity);
+	delta_rotation.Normalize();
+
+	FVector axis;
+	float angle;
+	delta_rotation.ToAxisAndAngle(axis, angle);
+
+	const FVector delta = segment.m_end - segment.m_start;
+
+	int32 num_steps = 1;
+	if (m_max_angle > 0.0f)
+	{
+		num_steps = FMath::Max(num_steps, FMath::CeilToInt(FMath::RadiansToDegrees(angle) / m_max_angle));
+	}
+	if (m_max_distance > 0.0f)
+	{
+		num_steps = FMath::Max(num_steps, FMath::CeilToInt(delta.Size() / m_max_distance));
+	}
+	num_steps = FMath::Min(num_steps, m_max_sub_steps);
+
+	if (num_steps <= 1)
+	{
+		out_segments.Add(segment);
+		return;
+	}
+
+	// Split movement into slide along rotation axis and rotation about a pivot, for no rotation it is just a straight line
+	const bool is_rotating = angle > UE_KINDA_SMALL_NUMBER;
+	const FVector axial_delta = is_rotating ? axis * FVector::DotProduct(delta, axis) : delta;
+	const FVector chord = delta - axial_delta;
+
+	// Pivot is on the perpendicular bisector of the chord, at a distance where the chord spans the angle
+	FVector pivot = FVector::ZeroVector;
+	if (is_rotating)
+	{
+		const float chord_length = chord.Size();
+		const float pivot_distance = (chord_length * 0.5f) / FMath::Tan(angle * 0.5f);
+		pivot = segment.m_start + chord * 0.5f + FVector::CrossProduct(axis, chord).GetSafeNormal() * pivot_distance;
+	}
+	const FVector start_offset = segment.m_start - pivot;
+
+	auto get_location = [&](float alpha) -> FVector
+	{
+		if (!is_rotating)
+		{
+			return segment.m_start + delta * alpha;
+		}
+
+		return pivot + FQuat(axis, angle * alpha).RotateVector(start_offset) + axial_delta * alpha;
+	};
+
+	FVector step_start = segment.m_start;
+	FQuat step_start_rotation = segment.m_start_rotation;
+	for (int32 step = 1; step <= num_steps; ++step)
+	{
+		const float alpha = float(step) / num_steps;
+		// Last step ends exactly on the end pose
+		const FVector step_end = step == num_steps ? segment.m_end : get_location(alpha);
+		const FQuat step_end_rotation = step == num_steps ? segment.m_end_rotation : FQuat::Slerp(segment.m_start_rotation, segment.m_end_rotation, alpha);
+
+		FCollisionTraceSegment& sub_step = out_segments.Add_GetRef(segment);
+		sub_step.m_start = step_start;
+		sub_step.m_end = step_end;
+		sub_step.m_start_rotation = step_start_rotation;
+		sub_step.m_end_rotation = step_end_rotation;
+
+		step_start = step_end;
+		step_start_rotation = step_end_rotation;
+	}
+}
+
+
+int32 FCollisionTracePool::AllocateSlot(int32 owner, int32 data_index)
+{
+	int32 slot = INDEX_NONE;
+	if (m_free_slots.Num() > 0)
+	{
+		slot = m_free_slots.Pop(EAllowShrinking::No);
+	}
+	else
+	{
+		slot = m_owners.Num();
+		m_prev_locations.AddZeroed();
+		m_curr_locations.AddZeroed();
+		m_prev_rotations.Add(FQuat::Identity);
+		m_curr_rotations.Add(FQuat::Identity);
+		m_extents.AddZeroed();
+		m_sub_step_settings.AddDefaulted();
+		m_owners.Add(INDEX_NONE);
+		m_data_indices.Add(INDEX_NONE);
+		m_is_due.Add(0);
+	}
+
+	m_owners[slot] = owner;
+	m_data_indices[slot] = data_index;
+	m_extents[slot] = FVector::ZeroVector;
+	m_sub_step_settings[slot] = FCollisionSubStepSettings();
+	m_is_due[slot] = 0;
+	return slot;
+}
+
+void FCollisionTracePool::FreeSlot(int32 slot)
+{
+	m_owners[slot] = INDEX_NONE;
+	m_data_indices[slot] = INDEX_NONE;
+	m_is_due[slot] = 0;
+	m_free_slots.Add(slot);
+}
+
+void FCollisionTracePool::CommitSlots(TConstArrayView<int32> slots)
+{
+	for (const int32 slot : slots)
+	{
+		if (m_is_due[slot])
+		{
+			m_prev_locations[slot] = m_curr_locations[slot];
+			m_prev_rotations[slot] = m_curr_rotations[slot];
+			m_is_due[slot] = 0;
+		}
+	}
+}
+
+void FCollisionTracePool::SweepSlots(TConstArrayView<int32> slots, TArray<FCollisionTraceSegment>& out_segments)
+{
+	for (const int32 slot : slots)
+	{
+		if (m_is_due[slot])
+		{
+			SweepSlot(slot, out_segments);
+		}
+	}
+}
+
+void FCollisionTracePool::SweepAllSlots(TArray<FCollisionTraceSegment>& out_segments, TArray<int32>& out_owners)
+{
+	const int32 num_slots = m_is_due.Num();
+	for (int32 slot = 0; slot < num_slots; ++slot)
+	{
+		if (m_is_due[slot])
+		{
+			// Slot can make more than one segment when it is sub stepped
+			const int32 first_segment = out_segments.Num();
+			SweepSlot(slot, out_segments);
+			for (int32 i = first_segment; i < out_segments.Num(); ++i)
+			{
+				out_owners.Add(m_owners[slot]);
+			}
+		}
+	}
+}
+
+void FCollisionTracePool::SweepSlot(int32 slot, TArray<FCollisionTraceSegment>& out_segments)
+{
+	FCollisionTraceSegment segment;
+	segment.m_data_index = m_data_indices[slot];
+	segment.m_start = m_prev_locations[slot];
+	segment.m_end = m_curr_locations[slot];
+	segment.m_start_rotation = m_prev_rotations[slot];
+	segment.m_end_rotation = m_curr_rotations[slot];
+	segment.m_radius = m_extents[slot].Size();
+	m_sub_step_settings[slot].AppendSegments(segment, out_segments);
+
+	m_prev_locations[slot] = m_curr_locations[slot];
+	m_prev_rotations[slot] = m_curr_rotations[slot];
+	m_is_due[slot] = 0;
+}
+
+
+void FCollisionAsyncTraceQueue::Init(int32 capacity, int32 hits_per_record)
+{
+	const uint32 num_records = FMath::RoundUpToPowerOfTwo(uint32(FMath::Max(capacity, 2)));
+
+	m_records.SetNum(num_records);
+	for (FCollisionAsyncTraceRecord& record : m_records)
+	{
+		record.m_hits.Reserve(hits_per_record);
+	}
+
+	m_sequences = MakeUnique<std::atomic<uint32>[]>(num_records);
+	for (uint32 index = 0; index < num_records; ++index)
+	{
+		m_sequences[index].store(index, std::memory_order_relaxed);
+	}
+
+	m_mask = num_records - 1;
+	m_push_position.store(0, std::memory_order_relaxed);
+	m_pop_position = 0;
+}
+
+bool FCollisionAsyncTraceQueue::Push(uint64 handle, uint32 route, const FVector& start, const FVector& end, const FQuat& rotation, TConstArrayView<FHitResult> hits)
+{
+	if (!IsInitialized()) return false;
+
+	uint32 position = m_push_position.load(std::memory_order_relaxed);
+	while (true)
+	{
+		const uint32 sequence = m_sequences[position & m_mask].load(std::memory_order_acquire);
+		const int32 difference = int32(sequence - position);
+
+		if (difference == 0)
+		{
+			// Record is free, try to claim it
+			if (m_push_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if (difference < 0)
+		{
+			// Consumer hasn't released the record from previous lap yet
+			return false;
+		}
+		else
+		{
+			// Another producer claimed it first
+			position = m_push_position.load(std::memory_order_relaxed);
+		}
+	}
+
+	FCollisionAsyncTraceRecord& record = m_records[position & m_mask];
+	record.m_handle = handle;
+	record.m_route = route;
+	record.m_start = start;
+	record.m_end = end;
+	record.m_rotation = rotation;
+	record.m_hits.Reset();
+	record.m_hits.Append(hits.GetData(), hits.Num());
+
+	m_sequences[position & m_mask].store(position + 1, std::memory_order_release);
+	return true;
+}
+
+void FCollisionAsyncTraceQueue::Acquire(TArray<const FCollisionAsyncTraceRecord*>& out_records)
+{
+	if (!IsInitialized()) return;
+
+	for (uint32 position = m_pop_position; ; ++position)
+	{
+		const uint32 sequence = m_sequences[position & m_mask].load(std::memory_order_acquire);
+		// Not published yet. After a full lap this also stops, since records of this lap aren't released yet.
+		if (sequence != position + 1) break;
+
+		out_records.Add(&m_records[position & m_mask]);
+	}
+}
+
+void FCollisionAsyncTraceQueue::Release(int32 num_records)
+{
+	for (int32 i = 0; i < num_records; ++i)
+	{
+		m_sequences[m_pop_position & m_mask].store(m_pop_position + m_mask + 1, std::memory_order_release);
+		++m_pop_position;
+	}
+}
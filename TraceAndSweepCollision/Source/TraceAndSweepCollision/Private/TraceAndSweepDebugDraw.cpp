@@ -7,7 +7,7 @@
 void TraceAndSweepDebugDraw::DrawLineTraces(const UWorld* world
 	, const FVector& start
 	, const FVector& end
-	, const TArray<FHitResult>& hits
+	, TConstArrayView<FHitResult> hits
 	, const bool is_draw_debug_trace_line
 	, const FColor& debug_line_color
 	, const float debug_line_duration
@@ -50,7 +50,7 @@ void TraceAndSweepDebugDraw::DrawBoxSweep(const UWorld* world
 	, const FVector& end
 	, const FVector& extent
 	, const FQuat& rot
-	, const TArray<FHitResult>& hits
+	, TConstArrayView<FHitResult> hits
 	, const bool is_draw_debug_box
 	, const FColor& debug_box_color
 	, const float debug_box_duration
@@ -125,7 +125,7 @@ void TraceAndSweepDebugDraw::DrawSphereSweep(const UWorld* world
 	, const FVector& start
 	, const FVector& end
 	, const float radius
-	, const TArray<FHitResult>& hits
+	, TConstArrayView<FHitResult> hits
 	, const bool is_draw_debug_sphere
 	, const FColor& debug_sphere_color
 	, const float debug_sphere_duration
@@ -169,7 +169,7 @@ void TraceAndSweepDebugDraw::DrawCapsuleSweep(const UWorld* world
 	, const float half_height
 	, const float radius
 	, const FQuat& rot
-	, const TArray<FHitResult>& hits
+	, TConstArrayView<FHitResult> hits
 	, const bool is_draw_debug_capsule
 	, const FColor& debug_capsule_color
 	, const float debug_capsule_duration
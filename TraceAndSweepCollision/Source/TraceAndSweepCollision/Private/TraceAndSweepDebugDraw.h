@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Math/Color.h"
+#include "Containers/ArrayView.h"
 
 
 namespace TraceAndSweepDebugDraw
@@ -10,7 +11,7 @@ namespace TraceAndSweepDebugDraw
     void DrawLineTraces(const UWorld* world
         , const FVector& start
         , const FVector& end
-        , const TArray<FHitResult>& hits
+        , TConstArrayView<FHitResult> hits
         , const bool is_draw_debug_trace_line
         , const FColor& debug_line_color
         , const float debug_line_duration
@@ -25,7 +26,7 @@ namespace TraceAndSweepDebugDraw
         , const FVector& end
         , const FVector& extent
         , const FQuat& rot
-        , const TArray<FHitResult>& hits
+        , TConstArrayView<FHitResult> hits
         , const bool is_draw_debug_box
         , const FColor& debug_box_color
         , const float debug_box_duration
@@ -39,7 +40,7 @@ namespace TraceAndSweepDebugDraw
         , const FVector& start
         , const FVector& end
         , const float radius
-        , const TArray<FHitResult>& hits
+        , TConstArrayView<FHitResult> hits
         , const bool is_draw_debug_sphere
         , const FColor& debug_sphere_color
         , const float debug_sphere_duration
@@ -55,7 +56,7 @@ namespace TraceAndSweepDebugDraw
         , const float half_height
         , const float radius
         , const FQuat& rot
-        , const TArray<FHitResult>& hits
+        , TConstArrayView<FHitResult> hits
         , const bool is_draw_debug_capsule
         , const FColor& debug_capsule_color
         , const float debug_capsule_duration
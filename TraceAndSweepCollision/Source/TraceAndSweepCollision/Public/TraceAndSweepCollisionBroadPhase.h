@@ -0,0 +1,69 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/WeakObjectPtrTemplates.h"
+#include "TraceAndSweepCollisionTypes.h"
+
+class UPrimitiveComponent;
+
+// Candidates of one segment, only a handful of targets are near a segment so this rarely leaves the stack
+using FCollisionCandidateArray = TArray<int32, TInlineAllocator<16>>;
+
+// World space shape of a broad phase target, copied from target component on game thread so that narrow phase can read it from any thread
+struct TRACEANDSWEEPCOLLISION_API FCollisionTargetShape
+{
+	// False if target isn't a box, capsule or sphere component, in which case only its bounds are known
+	bool m_is_simple_shape = false;
+	ECollisionCompShapeType m_shape_type = ECollisionCompShapeType::BOX;
+
+	FVector m_center = FVector::ZeroVector;
+	FQuat m_rotation = FQuat::Identity;
+
+	// Box half extent, (radius, radius, half height) for capsule and radius on all axis for sphere. Scale is already applied.
+	FVector m_extent = FVector::ZeroVector;
+};
+
+// Plugin side broad phase against a set of registered targets (Eg: hurtboxes).
+// Bounds of the targets are kept as structure of arrays padded to a multiple of 4,
+// so that a segment is tested against 4 target boxes at a time using vector registers.
+class TRACEANDSWEEPCOLLISION_API FCollisionBroadPhase
+{
+public:
+	void AddTarget(UPrimitiveComponent* target);
+	void RemoveTarget(UPrimitiveComponent* target);
+	void RemoveAllTargets();
+
+	// Refreshes bounds of every target from its component and drops targets that were removed or destroyed. Has to be called on game thread.
+	void UpdateTargets();
+
+	FORCEINLINE int32 NumTargets() const { return m_targets.Num(); }
+
+	// Target can be null if it was removed or destroyed after last update
+	FORCEINLINE const TWeakObjectPtr<UPrimitiveComponent>& GetTarget(int32 index) const { return m_targets[index]; }
+	FORCEINLINE const FCollisionTargetShape& GetTargetShape(int32 index) const { return m_shapes[index]; }
+
+	// Returns true if segment inflated by radius touches bounds of any target.
+	// Only reads the bounds, so it is safe to call from worker threads between calls of UpdateTargets.
+	bool OverlapsAnyTarget(const FVector& start, const FVector& end, float radius) const;
+
+	// Returns true if box touches bounds of any target, same threading rules as above
+	bool OverlapsAnyTarget(const FBox& box) const;
+
+	// Adds index of every target whose bounds the segment inflated by radius touches
+	void GatherCandidates(const FVector& start, const FVector& end, float radius, FCollisionCandidateArray& out_candidates) const;
+
+private:
+	// Returns 4 bit mask of which of the 4 targets starting at first_target are touched by segment
+	int32 TestFourTargets(int32 first_target, const FVector3f& start, const FVector3f& inv_direction, float radius) const;
+
+	TArray<TWeakObjectPtr<UPrimitiveComponent>> m_targets;
+	TArray<FCollisionTargetShape> m_shapes;
+
+	// World space bounds of targets, padding at the end is filled with boxes far outside of the world that can never be hit
+	TArray<float> m_min_x;
+	TArray<float> m_min_y;
+	TArray<float> m_min_z;
+	TArray<float> m_max_x;
+	TArray<float> m_max_y;
+	TArray<float> m_max_z;
+};
@@ -2,9 +2,19 @@
 
 #include "CoreMinimal.h"
 #include "Components/PrimitiveComponent.h"
+#include <atomic>
 #include "TraceAndSweepCollisionTypes.h"
 #include "TraceAndSweepCollisionComponent.generated.h"
 
+class USkeletalMeshComponent;
+class USkinnedAsset;
+class FCollisionBroadPhase;
+class FCollisionTelemetry;
+struct FCollisionTelemetryCounters;
+class ATraceAndSweepCollisionManager;
+struct FCollisionDebugRenderData;
+struct FOverlapResult;
+
 //For Unreal Profiler
 DECLARE_STATS_GROUP(TEXT("TraceAndSweepCollisionComponent"), STATGROUP_TraceAndSweepCollisionComponent, STATCAT_Advanced);
 
@@ -15,6 +25,8 @@ class TRACEANDSWEEPCOLLISION_API UTraceAndSweepCollisionComponent : public UPrim
 
 	// making component a friend of manager so that manager can manage the class without restrictions
 	friend class ATraceAndSweepCollisionManager;
+	// Benchmark sets up components the way they would be in editor
+	friend class UTraceAndSweepCollisionBenchmarkRunner;
 
 public:
 	UTraceAndSweepCollisionComponent();
@@ -25,47 +37,181 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "TraceAndSweepCollision")
 	void SetIsTraceCollisionEnabled(bool is_enabled);
 
+	// For pooled owners (Eg: projectiles). Teleports owner to transform and starts over from there: overlaps are forgotten without end overlap events,
+	// traces still in flight are dropped and the tracked lines and shapes are kept, so none of the work of BeginPlay is repeated.
+	UFUNCTION(BlueprintCallable, Category = "TraceAndSweepCollision")
+	void ResetForReuse(const FTransform& transform);
+
 	UFUNCTION(BlueprintCallable, Category = "TraceAndSweepCollision")
 	void AddSceneComponentToTrace(USceneComponent* scene_component);
 
 	UFUNCTION(BlueprintCallable, Category = "TraceAndSweepCollision")
 	void AddSceneComponentsToTrace(TArray<USceneComponent*> scene_components);
 
+	// Actors and components that are never hit by this component (Eg: wielder's team). Owner is always ignored.
+	UFUNCTION(BlueprintCallable, Category = "TraceAndSweepCollision")
+	void AddIgnoredActor(AActor* actor);
+
+	UFUNCTION(BlueprintCallable, Category = "TraceAndSweepCollision")
+	void RemoveIgnoredActor(AActor* actor);
+
+	UFUNCTION(BlueprintCallable, Category = "TraceAndSweepCollision")
+	void AddIgnoredComponent(UPrimitiveComponent* component);
+
+	UFUNCTION(BlueprintCallable, Category = "TraceAndSweepCollision")
+	void RemoveIgnoredComponent(UPrimitiveComponent* component);
+
+	UFUNCTION(BlueprintCallable, Category = "TraceAndSweepCollision")
+	void ClearIgnoredActorsAndComponents();
+
 	FORCEINLINE bool IsTraceCollisionEnabled() const { return m_is_trace_collision_enabled; }
 
+	// 0 when tracing at full rate, raised by manager when frame budget runs out
+	FORCEINLINE int32 GetTraceLod() const { return m_trace_lod; }
+
 protected:
 	// UPrimitiveComponent overrides
+	virtual void OnRegister() override;
 	virtual void BeginPlay() override;
 	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	virtual void TickComponent(float delta_time, ELevelTick tick_type, FActorComponentTickFunction* this_tick_function) override;
 	virtual FPrimitiveSceneProxy* CreateSceneProxy() override;
+	virtual void SendRenderDynamicData_Concurrent() override;
+	virtual void OnUpdateTransform(EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport) override;
 	// End UPrimitiveComponent overrides
 
 	//~ Begin USceneComponent Interface
 	virtual FBoxSphereBounds CalcBounds(const FTransform& LocalToWorld) const override;
 	//~ End USceneComponent Interface
 private:
-	// Wrapper for FHitResult since FHitResult doesn't have == operator
-	struct FHitResultWrapper
-	{
-		int32 m_count = 0;
-		FHitResult m_result;
-
-		FHitResultWrapper(const FHitResult& result);
-		bool operator==(const FHitResultWrapper& rhs) const;
-	};
-
+	void ResetCollisionTestResults();
+	// Everything that changes state read by a batch traced on worker threads calls this first, see ATraceAndSweepCollisionManager::RemoveFromPendingBatch
+	void RemoveFromPendingBatch();
 	bool DoCollisionTest();
 
-	bool DoSynchronousLineSingleCollisionTest();
-	bool DoSynchronousSweepSingleCollisionTest();
-	bool DoSynchronousLineMultiCollisionTest();
-	bool DoSynchronousSweepMultiCollisionTest();
+	bool DoSynchronousCollisionTest();
 
 	bool DoAsynchronousLineCollisionTest();
 	bool DoAsynchronousSweepCollisionTest();
 
+	// Async collision test waiting for its traces. Several can be in flight, they complete in the order they were started
+	// whatever order their traces come back in, so overlaps begin and end in the order the component moved.
+	struct FAsyncCollisionTest
+	{
+		// GFrameCounter when traces were started, for Max Async Result Latency
+		uint64 m_frame = 0;
+		uint64 m_start_cycles = 0;
+		int32 m_num_pending_traces = 0;
+		// Kept so that the test can be traced again on game thread if its results are late
+		TArray<FCollisionTraceSegment> m_segments;
+		// Hits of the traces that came back so far and of analytic segments
+		TArray<FHitResult> m_forward_hits;
+		TArray<FHitResult> m_reverse_hits;
+	};
+
+	// Async trace in flight, test is index into m_async_tests and segment is index into segments of that test
+	struct FAsyncTraceSlot
+	{
+		int32 m_test = INDEX_NONE;
+		int32 m_segment = INDEX_NONE;
+		bool m_is_reverse = false;
+		// Overlap at start of segment for Forward Diff, its hits are added to forward hits of the test
+		bool m_is_start_overlap = false;
+	};
+
+	// Where a line point or shape was on a tick that couldn't start a collision test
+	struct FCollisionStitchPoint
+	{
+		int32 m_data_index = INDEX_NONE;
+		FVector m_location = FVector::ZeroVector;
+		FQuat m_rotation = FQuat::Identity;
+	};
+
+	// Takes next free test of the ring, returns its index
+	int32 BeginAsyncCollisionTest();
+	// Finishes oldest tests while all of their traces are back
+	void CompleteAsyncCollisionTests();
+	// Called by manager every frame while tests are in flight. Oldest tests that waited longer than Max Async Result Latency are traced again on game thread
+	// and finished, results of their async traces are dropped when they arrive.
+	void EnforceAsyncResultLatency();
+	void RetraceAsyncCollisionTest(UWorld* world, int32 test_index);
+
+	// Remembers where lines or shapes are while async tests are in flight, so next test sweeps along the path they took instead of cutting the corner.
+	// Pool keeps one previous transform per slot, so pooled components aren't stitched.
+	void AddStitchPoints();
+
+	// Steps of a synchronous collision test. These are split up so that manager can batch segments of many components together.
+	// Gather and resolve has to run on game thread, execute only reads from component and is safe to call from worker threads.
+	// Query params are built once and only rebuilt after ignored actors or components change
+	const FCollisionQueryParams& GetQueryParams();
+	void GatherTraceSegments(TArray<FCollisionTraceSegment>& out_segments);
+	// Undoes what gathering the segment did to the previous transform of its line or shape, for a test that is dropped before it ran
+	void RestorePreviousTransform(const FCollisionTraceSegment& segment);
+	// Returns number of world queries made, 0 if segment was culled or resolved by analytic narrow phase
+	int32 ExecuteTraceSegment(UWorld* world, const FCollisionTraceSegment& segment, const FCollisionQueryParams& params, TArray<FHitResult>& out_forward_hits, TArray<FHitResult>& out_reverse_hits) const;
+	void ResolveTraceSegment(UWorld* world, const FCollisionTraceSegment& segment, TConstArrayView<FHitResult> forward_hits, TConstArrayView<FHitResult> reverse_hits);
+	void FinishCollisionTest();
+
 	// Helpers
+	// Parent mesh data shared by every line point lookup of one pass, so it is fetched once instead of per point
+	struct FLinePointSource
+	{
+		const USkeletalMeshComponent* m_skeletal_mesh = nullptr;
+		// Empty if cached socket indices can't be used (Eg: mesh follows leader pose), then sockets are found by name
+		TConstArrayView<FTransform> m_component_space_transforms;
+		FTransform m_component_transform = FTransform::Identity;
+	};
+	FLinePointSource MakeLinePointSource() const;
+
+	// returns true if the point that line data is tracking exists
+	bool GetLinePointLocation(const FCollisionLineData& line_data, const FLinePointSource& source, FVector& out_location) const;
+	bool GetLinePointTransform(const FCollisionLineData& line_data, const FLinePointSource& source, FTransform& out_transform) const;
+
+	FCollisionSubStepSettings MakeSubStepSettings() const;
+
+	// Box around the path of every line point and shape from where it was last traced to where it is now, along sub step arcs and with shape extent included
+	FBox CalcSweptBounds() const;
+
+	// Keeps capsules of last frame as previous and gathers current ones, for component vs component pass of manager.
+	// Line points are connected in the order they were added (Eg: along a blade), a single point is a sphere.
+	void UpdateComponentCapsules();
+	// True if actors and components of both allow them to hit each other
+	bool CanCollideWithComponent(const UTraceAndSweepCollisionComponent* other) const;
+
+	// Saves current transform of every line and shape as previous, so next trace starts from here
+	void SnapshotPreviousTransforms();
+
+	// Resolves bone index of every socket tracked by line data. Only looks up names when parent mesh changed or line data was added.
+	void RefreshSocketIndices();
+
+	void DrawDebugTrace(UWorld* world, const FCollisionTraceSegment& segment, TConstArrayView<FHitResult> hits) const;
+
+	// Scene proxy only draws a copy of the shapes made here on game thread, it never reads from the component.
+	// Transforms are world transforms of every tracked point (scale removed) or of every shape (offset applied).
+	void GatherDebugTransforms(TArray<FTransform>& out_transforms) const;
+	TUniquePtr<FCollisionDebugRenderData> MakeDebugRenderData(TConstArrayView<FTransform> transforms) const;
+	// Asks for new render data at end of frame if debug shapes are drawn, which is then only sent if something moved
+	void MarkDebugRenderDataDirty();
+
+	// Bounds are only used to cull debug drawing, so they aren't calculated for components that draw nothing or are hidden in game without "show collision"
+	bool ShouldCalcDebugBounds() const;
+	// Bounds of all shapes in component space, calculated on register since shape data only changes before that or in editor
+	void RefreshLocalShapeBounds();
+
+	// returns false if broad phase is used and segment doesn't pass near any of the targets, so there is no need to trace it
+	bool PassesBroadPhase(const FCollisionTraceSegment& segment) const;
+
+	// Analytic narrow phase against broad phase targets, used instead of world queries when every target near the segment is a simple shape.
+	// Returns false if segment has to be traced against the world instead.
+	bool ExecuteAnalyticSegment(const FCollisionTraceSegment& segment, TArray<FHitResult>& out_forward_hits, TArray<FHitResult>& out_reverse_hits) const;
+
+	// Trace pool helpers, only used when manager owns the transforms of lines and shapes
+	// Makes sure there is a pool slot for every line or shape
+	void RefreshPoolSlots();
+	void ReleasePoolSlots();
+	// Writes current transform of every line and shape into the pool
+	void WritePoolTransforms();
+
 	// returns true if trace or sweep is successfullly done
 	// NOTE: return boolean isn't if its blocking hit or not, but weather trace of sweep is done
 	bool DoLineSingle(FHitResult& out_result, UWorld* world, const FVector& start, const FVector& end, const FCollisionQueryParams& params) const;
@@ -73,30 +219,135 @@ private:
 	bool DoSweepSingle(FHitResult& out_result, UWorld* world, const FVector& start, const FVector& end, const FQuat rotation, const FCollisionShapeData& shape_data, const FCollisionQueryParams& params) const;
 	bool DoSweepMulti(TArray<FHitResult>& out_results, UWorld* world, const FVector& start, const FVector& end, const FQuat rotation, const FCollisionShapeData& shape_data, const FCollisionQueryParams& params, bool is_reverse = false) const;
 
+	// Overlap of the shape at one pose, with same channel and params as the sweeps
+	bool DoOverlapMulti(TArray<FOverlapResult>& out_results, UWorld* world, const FVector& location, const FQuat rotation, const FCollisionShapeData& shape_data, const FCollisionQueryParams& params) const;
+	// Adds a zero distance forward hit for every blocking object the shape is inside of at start of segment, for Forward Diff.
+	// Multi sweep only reports the first of those, so with more than one the others would end and begin again on every other test.
+	void AddStartOverlaps(UWorld* world, const FCollisionTraceSegment& segment, const FCollisionShapeData& shape_data, const FCollisionQueryParams& params, TArray<FHitResult>& out_forward_hits) const;
+	static void AppendStartOverlapHits(TConstArrayView<FOverlapResult> overlaps, const FVector& start, const FVector& end, TArray<FHitResult>& out_hits);
+
 	FTraceHandle DoAsyncLine(UWorld* world, const EAsyncTraceType trace_type, const FVector& start, const FVector& end, const FCollisionQueryParams& params, bool is_reverse = false);
 	FTraceHandle DoAsyncSweep(UWorld* world, const EAsyncTraceType trace_type, const FVector& start, const FVector& end, const FQuat rotation, const FCollisionShapeData& shape_data, const FCollisionQueryParams& params, bool is_reverse = false);
+	FTraceHandle DoAsyncOverlap(UWorld* world, const FVector& location, const FQuat rotation, const FCollisionShapeData& shape_data, const FCollisionQueryParams& params);
+
+	// Called by manager with completed async traces of this component. Finishes collision tests once all of their traces are back.
+	void ReceiveAsyncTraceResults(TConstArrayView<const FCollisionAsyncTraceRecord*> records);
+	void ReceiveAsyncTraceResult(uint64 handle, const FVector& start, const FVector& end, const FQuat& rotation, TConstArrayView<FHitResult> hits);
 
-	void OnAsyncTraceComplete(const FTraceHandle& handle, FTraceDatum& data);
+	// Remembers which test and segment the handle belongs to so that completion can find it without searching
+	void TrackAsyncTrace(const FTraceHandle& handle, int32 test_index, int32 segment_index, bool is_reverse, bool is_start_overlap = false);
+	// Clears handle kept in line or shape data, if it is still the latest trace of it
+	void ClearTraceHandle(uint64 handle, int32 data_index, bool is_reverse);
 
+	// Adds blocking hit of a forward trace, keeping the full hit result only if it can begin an overlap
+	void AddForwardHit(const FHitResult& hit);
 	void ProcessForwardHitResults();
 	void ProcessReverseHitResults();
+	// Ends every overlap that none of the forward traces of this collision test touched
+	void ProcessForwardDiffEndOverlaps();
+
+	// Null while component isn't registered with a manager
+	FCollisionTelemetryCounters* GetTelemetryCounters() const;
+	// Name collision tests of this component get in Insights, owner class and modes so they can be told apart in a capture
+	void RefreshTelemetryEventName();
+
+	FORCEINLINE bool ShouldTraceReverse() const { return m_should_generate_end_overlap && m_end_overlap_type == ECollisionCompEndOverlapType::REVERSE_TRACE; }
+	FORCEINLINE bool ShouldQueryStartOverlaps() const { return m_should_generate_end_overlap && m_end_overlap_type == ECollisionCompEndOverlapType::FORWARD_DIFF && m_style_type == ECollisionCompStyleType::SWEEP; }
 
 	// Called from manager
 	void ExternalTick();
 
+	// Manager this component is registered with and its slot there
+	TWeakObjectPtr<ATraceAndSweepCollisionManager> m_manager;
+	int32 m_manager_slot = INDEX_NONE;
+	// Parked in manager's pool, stays registered but is skipped until acquired again
+	bool m_is_pooled = false;
+
 	// tick times being used by manager
 	float m_time_elapsed = 0.0f;
 	float m_tick_interval = 0.0f;
+	// Fraction of the interval this component is offset by, given by manager so that components spawned together don't all trace on same frame
+	float m_tick_phase = 0.0f;
+	int32 m_trace_lod = 0;
 
 	bool m_is_previous_trace_complete = true;
-	FTraceDelegate m_async_trace_delegate;
+
+	// Skinned asset the socket indices of line data were resolved against
+	TObjectKey<USkinnedAsset> m_socket_indices_asset;
+	bool m_are_socket_indices_dirty = true;
+
+	// Cached params for every trace, rebuilt on game thread when dirty so worker threads only ever read them
+	FCollisionQueryParams m_query_params;
+	FCollisionObjectQueryParams m_object_query_params;
+	bool m_are_query_params_dirty = true;
+
+	UPROPERTY(Transient)
+	TArray<AActor*> m_ignored_actors;
+
+	UPROPERTY(Transient)
+	TArray<UPrimitiveComponent*> m_ignored_components;
+
+	// Manager's delegate that queues async trace completions, route is passed as user data so manager knows which component the trace belongs to
+	const FTraceDelegate* m_async_trace_delegate = nullptr;
+	const FOverlapDelegate* m_async_overlap_delegate = nullptr;
+	uint32 m_async_route = 0;
+
+	// Handle of each async trace in flight mapped to its slot
+	TMap<uint64, FAsyncTraceSlot> m_async_trace_slots;
+
+	// Number of async traces of all tests in flight that haven't completed yet
+	std::atomic<int32> m_num_pending_async_traces = 0;
+
+	// Ring of async tests, sized to Max Async Tests In Flight on first use. Oldest test in flight is at m_first_async_test.
+	TArray<FAsyncCollisionTest> m_async_tests;
+	int32 m_first_async_test = 0;
+	int32 m_num_async_tests = 0;
+
+	// Ticks missed in a row past this are joined into one straight sweep
+	static constexpr int32 max_stitched_ticks = 8;
+	// Consumed by next GatherTraceSegments, in the order they were added
+	TArray<FCollisionStitchPoint> m_stitch_points;
+	int32 m_num_stitched_ticks = 0;
+
+	// Set by manager when it owns previous and current transforms. One slot per line or shape data.
+	FCollisionTracePool* m_trace_pool = nullptr;
+	TArray<int32> m_pool_slots;
+	int32 m_pool_owner = INDEX_NONE;
+
+	// Targets registered with manager, set when component is registered
+	const FCollisionBroadPhase* m_broad_phase = nullptr;
+
+	// Telemetry of manager and index of counters of owner's class in it, set when component is registered
+	FCollisionTelemetry* m_telemetry = nullptr;
+	int32 m_telemetry_archetype = INDEX_NONE;
+	FString m_telemetry_event_name;
 
 	// Temporary cache for all the hit results from current collision test
-	TArray<FHitResultWrapper> m_forward_hit_results;
-	TArray<FHitResultWrapper> m_reverse_hit_results;
+	FCollisionHitSet m_forward_hit_results;
+	FCollisionHitSet m_reverse_hit_results;
+
+	// Full hit results of forward hits that weren't overlapped when they were added, pointed to by m_result_index of forward hit entries
+	TArray<FHitResult> m_begin_overlap_results;
 
 	// Saved begin overlaps, so that end overlaps can be called
-	TArray<FHitResultWrapper> m_overlapped_results;
+	FCollisionHitSet m_overlapped_results;
+
+	// Reused by every collision test on game thread, only grow and never shrink
+	TArray<FCollisionTraceSegment> m_scratch_segments;
+	TArray<FHitResult> m_scratch_forward_hits;
+	TArray<FHitResult> m_scratch_reverse_hits;
+	// Sub steps of the path since last trace, for swept bounds
+	mutable TArray<FCollisionTraceSegment> m_swept_bounds_segments;
+
+	// Transforms that the scene proxy's render data was last made from
+	TArray<FTransform> m_debug_render_transforms;
+	TArray<FTransform> m_debug_scratch_transforms;
+
+	FBox m_local_shape_bounds = FBox(ForceInit);
+
+	// Component vs component capsules of current and last frame, same order in both
+	TArray<FCollisionComponentCapsule> m_component_capsules;
+	TArray<FCollisionComponentCapsule> m_previous_component_capsules;
 
 
 	UPROPERTY(BlueprintReadonly, Transient, Category = "TraceAndSweepCollision", meta = (DisplayName = "Is Trace Collision Enabled", AllowPrivateAccess))
@@ -106,6 +357,10 @@ private:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadonly, Category = "TraceAndSweepCollision", meta = (DisplayName = "Traces Per Second", MinValue = 0, AllowPrivateAccess))
 	float m_traces_per_second = 30.0f;
 
+	// Relative importance when manager has a frame budget, higher runs first. Distance to local players and velocity are also taken into account.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadonly, Category = "TraceAndSweepCollision", meta = (DisplayName = "Schedule Priority", ClampMin = 0, AllowPrivateAccess))
+	float m_schedule_priority = 1.0f;
+
 	// Should start with collision enabled
 	UPROPERTY(EditDefaultsOnly, BlueprintReadonly, Category = "TraceAndSweepCollision", meta = (DisplayName = "Start With Collision Enabled", AllowPrivateAccess))
 	bool m_start_with_collision_enabled = true;
@@ -114,15 +369,49 @@ private:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadonly, Category = "TraceAndSweepCollision", meta = (DisplayName = "Should Generate End Overlap", AllowPrivateAccess))
 	bool m_should_generate_end_overlap = true;
 
+	// How end overlaps are found. Forward Diff replaces the reverse sweep of every segment with an overlap at its start, which is cheaper than a sweep.
+	// Only multi sweeps report objects they start inside of, which Forward Diff relies on, so other combinations always use Reverse Trace.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadonly, Category = "TraceAndSweepCollision", meta = (DisplayName = "End Overlap Type", EditCondition = "m_should_generate_end_overlap && m_style_type == ECollisionCompStyleType::SWEEP && m_trace_type == ECollisionCompTraceType::MULTI", AllowPrivateAccess))
+	ECollisionCompEndOverlapType m_end_overlap_type = ECollisionCompEndOverlapType::REVERSE_TRACE;
+
 	// Use Synchronous or Asynchronous tracing
 	UPROPERTY(EditDefaultsOnly, BlueprintReadonly, Category = "TraceAndSweepCollision", meta = (DisplayName = "Execution Type", AllowPrivateAccess))
 	ECollisionCompExecutionType m_execution_type = ECollisionCompExecutionType::ASYNCHRONOUS;
 
+	// Collision tests that can wait for their async traces at the same time. With more than 1, a frame where async traces are slow doesn't stop the next test from starting.
+	// Ticks that still can't start a test are stitched into the next one, so the whole path is traced either way.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadonly, Category = "TraceAndSweepCollision", meta = (DisplayName = "Max Async Tests In Flight", ClampMin = 1, ClampMax = 8, EditCondition = "m_execution_type == ECollisionCompExecutionType::ASYNCHRONOUS", AllowPrivateAccess))
+	int32 m_max_async_tests_in_flight = 1;
+
+	// Frames a collision test waits for its async traces before it is traced on game thread instead, and the late results are dropped. 0 to wait however long it takes.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadonly, Category = "TraceAndSweepCollision", meta = (DisplayName = "Max Async Result Latency (frames)", ClampMin = 0, EditCondition = "m_execution_type == ECollisionCompExecutionType::ASYNCHRONOUS", AllowPrivateAccess))
+	int32 m_max_async_result_latency = 0;
+
 	// Use Single or Multi
 	UPROPERTY(EditDefaultsOnly, BlueprintReadonly, Category = "TraceAndSweepCollision", meta = (DisplayName = "Trace Type", AllowPrivateAccess))
 	ECollisionCompTraceType m_trace_type = ECollisionCompTraceType::SINGLE;
 
 
+	// Only trace segments that pass near one of the broad phase targets registered with manager (Eg: when only hurtboxes can be hit).
+	// NOTE: If no targets are registered nothing will be traced.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadonly, Category = "TraceAndSweepCollision", meta = (DisplayName = "Use Broad Phase", AllowPrivateAccess))
+	bool m_use_broad_phase = false;
+
+	// Sweep against broad phase targets analytically instead of querying the physics scene. Works when the targets are box, capsule or sphere components.
+	// Spheres and capsules are tested against spheres and capsules, boxes against boxes and lines against all three. Any other pair falls back to world query.
+	// NOTE: Channels and query params are not used, every registered target that is touched is a hit.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadonly, Category = "TraceAndSweepCollision", meta = (DisplayName = "Use Analytic Narrow Phase", EditCondition = "m_use_broad_phase", AllowPrivateAccess))
+	bool m_use_analytic_narrow_phase = false;
+
+	// Test against other components with this enabled, so they can hit each other without physics bodies (Eg: interceptable missiles, parrying blades).
+	// Lines and shapes are tested as capsules moving over the frame. Fires the usual begin and end overlap events, with the other component as other component.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadonly, Category = "TraceAndSweepCollision", meta = (DisplayName = "Collide With Other Components", AllowPrivateAccess))
+	bool m_collide_with_components = false;
+
+	// Added to radius of lines and shapes in component vs component tests, lines are infinitely thin otherwise (Eg: radius of a bullet)
+	UPROPERTY(EditDefaultsOnly, BlueprintReadonly, Category = "TraceAndSweepCollision", meta = (DisplayName = "Component Collision Radius", ClampMin = 0, EditCondition = "m_collide_with_components", AllowPrivateAccess))
+	float m_component_collision_radius = 0.0f;
+
 	// Use Object type or Trace channel or Collision preset
 	UPROPERTY(EditDefaultsOnly, BlueprintReadonly, Category = "TraceAndSweepCollision", meta = (DisplayName = "Channel Type", AllowPrivateAccess))
 	ECollisionCompChannelType m_channel_type = ECollisionCompChannelType::COLLISION_PRESET;
@@ -155,6 +444,18 @@ private:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadonly, Category = "TraceAndSweepCollision", meta = (DisplayName = "Shapes List", EditCondition = "m_style_type == ECollisionCompStyleType::SWEEP", EditConditionHides, AllowPrivateAccess, TitleProperty = "m_shape_type"))
 	TArray<FCollisionShapeData> m_collision_shape_data;
 
+	// Split sweep into sub steps when shape turns more than this many degrees in one collision test, so that fast swings follow their arc. 0 to disable.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadonly, Category = "TraceAndSweepCollision", meta = (DisplayName = "Max Sub Step Angle", ClampMin = 0, EditCondition = "m_style_type == ECollisionCompStyleType::SWEEP", EditConditionHides, AllowPrivateAccess))
+	float m_max_sub_step_angle = 0.0f;
+
+	// Split sweep into sub steps when shape moves more than this distance in one collision test. 0 to disable.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadonly, Category = "TraceAndSweepCollision", meta = (DisplayName = "Max Sub Step Distance", ClampMin = 0, EditCondition = "m_style_type == ECollisionCompStyleType::SWEEP", EditConditionHides, AllowPrivateAccess))
+	float m_max_sub_step_distance = 0.0f;
+
+	// Upper limit of sub steps per shape in one collision test
+	UPROPERTY(EditDefaultsOnly, BlueprintReadonly, Category = "TraceAndSweepCollision", meta = (DisplayName = "Max Sub Steps", ClampMin = 1, EditCondition = "m_style_type == ECollisionCompStyleType::SWEEP", EditConditionHides, AllowPrivateAccess))
+	int32 m_max_sub_steps = 8;
+
 
 
 	/** Whether we should trace against complex collision */
@@ -2,6 +2,12 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "WorldCollision.h"
+#include "Tasks/Task.h"
+#include "TraceAndSweepCollisionTypes.h"
+#include "TraceAndSweepCollisionBroadPhase.h"
+#include "TraceAndSweepCollisionSweptVolumeGrid.h"
+#include "TraceAndSweepCollisionTelemetry.h"
 #include "TraceAndSweepCollisionManager.generated.h"
 
 class UTraceAndSweepCollisionComponent;
@@ -11,6 +17,9 @@ class TRACEANDSWEEPCOLLISION_API ATraceAndSweepCollisionManager : public AActor
 {
 	GENERATED_BODY()
 
+	// Benchmark ticks the manager itself to measure it
+	friend class UTraceAndSweepCollisionBenchmarkRunner;
+
 public:	
 	// Sets default values for this actor's properties
 	ATraceAndSweepCollisionManager();
@@ -18,12 +27,252 @@ public:
 	void RegisterComponent(UTraceAndSweepCollisionComponent* component);
 	void UnregisterComponent(UTraceAndSweepCollisionComponent* component);
 
+	// Targets for broad phase (Eg: hurtboxes). Components that use broad phase skip every segment that doesn't pass near one of these.
+	UFUNCTION(BlueprintCallable, Category = "TraceAndSweepCollision")
+	void RegisterBroadPhaseTarget(UPrimitiveComponent* target);
+
+	UFUNCTION(BlueprintCallable, Category = "TraceAndSweepCollision")
+	void UnregisterBroadPhaseTarget(UPrimitiveComponent* target);
+
+	// Parks component in the pool instead of destroying its owner. Component stays registered with its slot, pool slots and settings,
+	// only its trace collision is disabled. Hiding or disabling the owner actor is up to the game.
+	UFUNCTION(BlueprintCallable, Category = "TraceAndSweepCollision")
+	void ReleaseComponentToPool(UTraceAndSweepCollisionComponent* component);
+
+	// Takes a parked component whose owner is of owner_class, resets it for reuse at transform and enables its trace collision.
+	// Returns null if there is none, then spawn a new owner as usual.
+	UFUNCTION(BlueprintCallable, Category = "TraceAndSweepCollision")
+	UTraceAndSweepCollisionComponent* AcquirePooledComponent(TSubclassOf<AActor> owner_class, const FTransform& transform);
+
+	// Components whose path this frame passes through box (Eg: incoming projectiles for AI). Path is from where a component was last traced
+	// to where it was at the start of the manager's tick. Empty unless Use Swept Volume Grid is enabled.
+	UFUNCTION(BlueprintCallable, Category = "TraceAndSweepCollision")
+	void QuerySweptVolumes(const FBox& box, TArray<UTraceAndSweepCollisionComponent*>& out_components) const;
+
+	// Counters and histograms of every component of this manager, see TraceAndSweepCollision.Telemetry
+	FORCEINLINE FCollisionTelemetry& GetTelemetry() { return m_telemetry; }
+
 protected:
+	virtual void PostInitializeComponents() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
 
 private:	
+	// Hit results of a single segment in the batch
+	struct FBatchedTraceResult
+	{
+		TArray<FHitResult> m_forward_hits;
+		TArray<FHitResult> m_reverse_hits;
+		// World queries made for the segment, counted on game thread when results are dispatched
+		int32 m_num_traces = 0;
+	};
+
+	// Capsule of a component in the component vs component pass
+	struct FComponentCapsuleRef
+	{
+		int32 m_slot = INDEX_NONE;
+		int32 m_capsule = INDEX_NONE;
+		// Around the capsule at last and this frame
+		FBox m_bounds = FBox(ForceInit);
+	};
+
+	// First touch found between two components this frame, a is the one the normal points to
+	struct FComponentContact
+	{
+		uint64 m_key = 0;
+		int32 m_slot_a = INDEX_NONE;
+		int32 m_slot_b = INDEX_NONE;
+		float m_time = 0.0f;
+		// Centers of a and b at time of impact, impact point is where they touch so it is same for both
+		FVector m_location = FVector::ZeroVector;
+		FVector m_other_location = FVector::ZeroVector;
+		FVector m_impact_point = FVector::ZeroVector;
+		FVector m_normal = FVector::ZeroVector;
+	};
+
+	// Component that is due this frame, in order it will run
+	struct FScheduledComponent
+	{
+		UTraceAndSweepCollisionComponent* m_component = nullptr;
+		// Slot in m_components
+		int32 m_index = INDEX_NONE;
+		float m_priority = 0.0f;
+		// Interval the component was due for, including trace LOD
+		float m_interval = 0.0f;
+	};
+
+	// Finds components that are due this frame. With a frame budget they are sorted by priority, highest first.
+	void ScheduleComponents(float delta_time);
+	void GatherViewLocations();
+	float GetSchedulePriority(const UTraceAndSweepCollisionComponent* comp, float interval) const;
+
+	// Time spent on collision this frame in microseconds
+	double GetSpentBudget() const;
+	bool IsOverBudget(double estimated_us = 0.0) const;
+
+	// Called when a scheduled component runs. Keeps the time past its interval instead of resetting to 0, so component stays on its phase.
+	void ConsumeTickInterval(const FScheduledComponent& scheduled) const;
+
+	// Runs scheduled components one at a time until frame budget is used up
+	void TickScheduled();
+
+	// Gathers segments of scheduled synchronous components, traces them on worker threads
+	// and then dispatches the results back to the components in the order they were gathered.
+	// Also used when trace pool is enabled, in which case segments are made in one pass over the pool.
+	void TickBatched();
+	// Traces gathered segments, only reads from components and world so it can run off game thread
+	void ExecuteBatch(UWorld* world);
+	void DispatchBatch(UWorld* world);
+
+	// Batch that was launched to run while other worlds tick. Waiting leaves results for FinishPendingBatch to dispatch,
+	// which then runs the component pass of that frame.
+	void WaitForPendingBatch();
+	void FinishPendingBatch();
+	// Waits for the batch in flight and takes component out of it, so that its ignore lists, shapes and query params can change on game thread.
+	// Its test is dropped without events and its previous transforms are put back, so next test traces the same path.
+	void RemoveFromPendingBatch(UTraceAndSweepCollisionComponent* component);
+
+	// Tests components with Collide With Other Components enabled against each other, using their capsules of last and this frame.
+	// Fires begin overlap for pairs that started touching and end overlap for pairs that stopped.
+	void TickComponentCollision();
+	void BroadcastComponentBeginOverlap(int32 slot, int32 other_slot, const FVector& location, const FVector& impact_point, const FVector& normal, float time) const;
+	void BroadcastComponentEndOverlap(int32 slot, int32 other_slot) const;
+	// Forgets pairs of the slot without end overlap events, for when the component leaves or starts over
+	void RemoveComponentOverlapPairs(int32 slot);
+
+	// Smaller slot is in the upper half, so sorted keys are ordered by first component of the pair
+	static FORCEINLINE uint64 MakeComponentPairKey(int32 slot_a, int32 slot_b) { return (uint64(FMath::Min(slot_a, slot_b)) << 32) | uint32(FMath::Max(slot_a, slot_b)); }
+
+	// Raises trace LOD of components that were deferred for lack of budget and lowers it again when there is budget to spare
+	void UpdateTraceLods();
+
+	// Single delegate for async traces of all components, only queues the result
+	void OnAsyncTraceComplete(const FTraceHandle& handle, FTraceDatum& data);
+	// Same for start overlaps of Forward Diff, queued as hits
+	void OnAsyncOverlapComplete(const FTraceHandle& handle, FOverlapDatum& data);
+	// Drains async trace queue and hands the results to each component in one call
+	void DispatchAsyncTraces();
+
+	// Registered components by slot. Slots never move, unregistering leaves a hole that the next registration fills,
+	// so registering and unregistering are constant time and the slot can be used as pool owner and async route.
+	// A reused slot can't pick up stale async results since component only accepts handles it is waiting for.
 	TArray<UTraceAndSweepCollisionComponent*> m_components;
+	TArray<int32> m_free_component_slots;
 
-};
+	// Slots of parked components by class of their owner. Weak, since map isn't seen by garbage collection and a Blueprint class can be unloaded.
+	TMap<TWeakObjectPtr<UClass>, TArray<int32>> m_pooled_component_slots;
+
+	// Scheduler state for the current tick
+	TArray<FScheduledComponent> m_scheduled_components;
+	// Scheduled components past this index were deferred to a later frame
+	int32 m_num_run_components = 0;
+	uint64 m_frame_start_cycles = 0;
+	TArray<FVector> m_view_locations;
+	// Smoothed cost of tracing and dispatching one batched segment, used to keep batches within budget
+	double m_estimated_segment_cost_us = 5.0;
+	// Number of phases handed out, see RegisterComponent
+	uint32 m_num_tick_phases = 0;
+
+	FCollisionBroadPhase m_broad_phase;
+
+	FCollisionTelemetry m_telemetry;
+
+	// Swept volume of every enabled component by slot, rebuilt when components are scheduled
+	FCollisionSweptVolumeGrid m_swept_volume_grid;
+	mutable TArray<int32> m_swept_volume_query_slots;
+
+	// Component vs component pass, buffers are kept between frames
+	TArray<FComponentCapsuleRef> m_component_capsule_refs;
+	FCollisionSweptVolumeGrid m_component_capsule_grid;
+	TArray<int32> m_component_capsule_candidates;
+	TArray<FComponentContact> m_component_contacts;
+	TArray<int32> m_began_component_contacts;
+	TArray<uint64> m_ended_component_pairs;
+	// Keys of pairs that were touching at the end of last pass, sorted
+	TArray<uint64> m_component_overlap_pairs;
+
+	// Previous and current transforms of every line and shape, used when m_use_trace_pool is enabled
+	FCollisionTracePool m_trace_pool;
+	// Batch index of each component in m_components for the current tick, INDEX_NONE if component isn't in the batch
+	TArray<int32> m_component_batch_indices;
+
+	// Buffers for batched execution. These are kept around between frames so that they don't need to be reallocated.
+	TArray<UTraceAndSweepCollisionComponent*> m_batched_components;
+	// Points to cached params of each component, they don't change while the batch is traced
+	TArray<const FCollisionQueryParams*> m_batched_params;
+	TArray<FCollisionTraceSegment> m_batched_segments;
+	TArray<int32> m_batched_segment_owners;
+	TArray<FBatchedTraceResult> m_batched_results;
+	uint64 m_batch_execute_cycles = 0;
+
+	UE::Tasks::FTask m_pending_batch_task;
+	// Tick cost of the frame that launched the pending batch, sampled together with its dispatch once it is finished
+	double m_pending_tick_seconds = 0.0;
+	// Component pass of the frame that launched the pending batch, run after the batch is dispatched
+	bool m_is_component_collision_pending = false;
+	FDelegateHandle m_end_frame_handle;
+	FDelegateHandle m_pre_garbage_collect_handle;
+
+	// Completed async traces of all components, drained once per tick
+	FTraceDelegate m_async_trace_delegate;
+	FOverlapDelegate m_async_overlap_delegate;
+	TArray<FHitResult> m_async_overlap_hits;
+	FCollisionAsyncTraceQueue m_async_trace_queue;
+	TArray<const FCollisionAsyncTraceRecord*> m_async_records;
+
+	// Run synchronous traces of all components as one batch spread across worker threads instead of one component at a time.
+	// Asynchronous components are not effected by this.
+	UPROPERTY(EditAnywhere, Category = "TraceAndSweepCollision", meta = (DisplayName = "Use Batched Execution"))
+	bool m_use_batched_execution = false;
 
+	// Trace the batch on worker threads while the other worlds of the process (Eg: several dedicated server instances) tick, and hand out the results at end of frame.
+	// Manager then ticks last in its world. Results are same as without it, as long as frame budget is off, because that depends on time.
+	UPROPERTY(EditAnywhere, AdvancedDisplay, Category = "TraceAndSweepCollision", meta = (DisplayName = "Overlap Batch With Other Worlds", EditCondition = "m_use_batched_execution"))
+	bool m_overlap_batch_with_other_worlds = false;
+
+	// Keep previous and current transforms of all the lines and shapes in manager owned contiguous arrays instead of inside each component.
+	// Start and end of every segment is then computed in one linear pass. Has to be set before components are registered.
+	UPROPERTY(EditAnywhere, Category = "TraceAndSweepCollision", meta = (DisplayName = "Use Trace Pool"))
+	bool m_use_trace_pool = false;
+
+	// Number of segments each worker thread picks up at a time. Batches smaller than this are traced on game thread.
+	UPROPERTY(EditAnywhere, AdvancedDisplay, Category = "TraceAndSweepCollision", meta = (DisplayName = "Min Segments Per Worker", ClampMin = 1, EditCondition = "m_use_batched_execution"))
+	int32 m_min_segments_per_worker = 16;
+
+	// Keep a grid of the paths all components sweep this frame, for Query Swept Volumes
+	UPROPERTY(EditAnywhere, Category = "TraceAndSweepCollision", meta = (DisplayName = "Use Swept Volume Grid"))
+	bool m_use_swept_volume_grid = false;
+
+	// Size of one grid cell, used by swept volume grid and by component vs component pass. Around the distance a typical component moves in a frame works best.
+	UPROPERTY(EditAnywhere, AdvancedDisplay, Category = "TraceAndSweepCollision", meta = (DisplayName = "Swept Volume Cell Size", ClampMin = 1))
+	float m_swept_volume_cell_size = 1000.0f;
+
+	// Maximum time in microseconds the manager spends on collision per frame. Components that don't fit are deferred to next frame
+	// in priority order (distance to local players, velocity and component's Schedule Priority), and ones that keep getting deferred trace less often.
+	// Highest priority component always runs. 0 for no limit.
+	UPROPERTY(EditAnywhere, Category = "TraceAndSweepCollision", meta = (DisplayName = "Frame Budget (us)", ClampMin = 0))
+	float m_frame_budget_us = 0.0f;
+
+	// Highest trace LOD, at LOD n a component traces every (n + 1) intervals
+	UPROPERTY(EditAnywhere, AdvancedDisplay, Category = "TraceAndSweepCollision", meta = (DisplayName = "Max Trace LOD", ClampMin = 0, EditCondition = "m_frame_budget_us > 0"))
+	int32 m_max_trace_lod = 3;
+
+	// Priority is halved at this distance from closest local player
+	UPROPERTY(EditAnywhere, AdvancedDisplay, Category = "TraceAndSweepCollision", meta = (DisplayName = "Priority Reference Distance", ClampMin = 1, EditCondition = "m_frame_budget_us > 0"))
+	float m_priority_reference_distance = 5000.0f;
+
+	// Priority is doubled when owner moves at this speed
+	UPROPERTY(EditAnywhere, AdvancedDisplay, Category = "TraceAndSweepCollision", meta = (DisplayName = "Priority Reference Speed", ClampMin = 1, EditCondition = "m_frame_budget_us > 0"))
+	float m_priority_reference_speed = 1000.0f;
+
+	// Maximum number of completed async traces that can wait for dispatch. When full, results are handed to the component right away.
+	// Allocated when the first asynchronous component registers.
+	UPROPERTY(EditAnywhere, AdvancedDisplay, Category = "TraceAndSweepCollision", meta = (DisplayName = "Async Trace Queue Capacity", ClampMin = 2))
+	int32 m_async_trace_queue_capacity = 16384;
+
+	// Number of hits preallocated for each queued async trace. Multi traces with more hits grow the buffer once and keep it.
+	UPROPERTY(EditAnywhere, AdvancedDisplay, Category = "TraceAndSweepCollision", meta = (DisplayName = "Async Trace Queue Hits Per Trace", ClampMin = 0))
+	int32 m_async_trace_queue_hits_per_trace = 4;
+};
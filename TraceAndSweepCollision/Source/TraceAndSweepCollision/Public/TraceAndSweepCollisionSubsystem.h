@@ -0,0 +1,32 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TraceAndSweepCollisionSubsystem.generated.h"
+
+class ATraceAndSweepCollisionManager;
+
+// Knows the manager of its world, so components find it without going through the actors of the world.
+// Manager placed in the level is used if there is one, otherwise one with default settings is spawned the first time it is needed.
+UCLASS()
+class TRACEANDSWEEPCOLLISION_API UTraceAndSweepCollisionSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Returns null only while the world is being torn down
+	ATraceAndSweepCollisionManager* GetManager();
+	// Same without spawning one, null if the world has no manager yet
+	ATraceAndSweepCollisionManager* FindManager() const;
+
+	// Called by manager when it is initialized and when it leaves play
+	void SetManager(ATraceAndSweepCollisionManager* manager);
+	void ClearManager(ATraceAndSweepCollisionManager* manager);
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type world_type) const override;
+
+private:
+	UPROPERTY(Transient)
+	ATraceAndSweepCollisionManager* m_manager = nullptr;
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Uniform grid of the boxes around the paths components sweep in one frame, rebuilt by the manager every tick.
+// Cells are kept as one sorted array instead of a map, so rebuilding it reuses the same memory every frame.
+class TRACEANDSWEEPCOLLISION_API FCollisionSweptVolumeGrid
+{
+public:
+	// Drops every volume and starts over with given cell size
+	void Reset(float cell_size);
+
+	// Owner is returned by queries (Eg: slot of the component in manager)
+	void Add(int32 owner, const FBox& swept_bounds);
+
+	// Has to be called after adding and before querying
+	void Build();
+
+	FORCEINLINE int32 Num() const { return m_volumes.Num(); }
+
+	// Adds owner of every volume that touches box, each owner once
+	void Query(const FBox& box, TArray<int32>& out_owners) const;
+
+private:
+	struct FCellEntry
+	{
+		uint64 m_cell_key = 0;
+		int32 m_volume = INDEX_NONE;
+	};
+
+	FIntVector GetCell(const FVector& location) const;
+	static uint64 MakeCellKey(int32 x, int32 y, int32 z);
+
+	// Volumes that cover more cells than this are tested directly by every query instead of being put in cells (Eg: a very fast projectile)
+	static constexpr int32 max_cells_per_volume = 64;
+
+	float m_cell_size = 1000.0f;
+
+	TArray<FBox> m_volumes;
+	TArray<int32> m_owners;
+	// Sorted by cell key after Build
+	TArray<FCellEntry> m_cell_entries;
+	TArray<int32> m_large_volumes;
+};
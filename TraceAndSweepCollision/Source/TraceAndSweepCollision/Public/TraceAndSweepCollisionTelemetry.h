@@ -0,0 +1,95 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Trace/Trace.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+class UClass;
+
+// Insights channel of the plugin, scopes on it are only recorded when it is enabled (Eg: -trace=cpu,TraceAndSweepCollision).
+// Every collision test shows up with owner class and modes of its component, so a capture tells which archetype the time goes to.
+UE_TRACE_CHANNEL_EXTERN(TraceAndSweepCollisionChannel, TRACEANDSWEEPCOLLISION_API);
+
+// Totals of the components whose owners are of one class (Eg: a weapon archetype), since telemetry was last reset
+struct TRACEANDSWEEPCOLLISION_API FCollisionTelemetryCounters
+{
+	// Path name of owner class
+	FName m_archetype;
+	int64 m_num_collision_tests = 0;
+	// World queries only, segments culled by broad phase or resolved by analytic narrow phase aren't traces
+	int64 m_num_traces = 0;
+	// Unique forward hits of every collision test
+	int64 m_num_hits = 0;
+	int64 m_num_begin_overlaps = 0;
+	int64 m_num_end_overlaps = 0;
+	// Game thread time of collision tests. Batched segments are traced together, so each one gets the average cost of its batch.
+	double m_seconds = 0.0;
+};
+
+// Histogram with buckets that grow by a fixed ratio, so it keeps the same relative precision from tenths of a microsecond to seconds
+// in a fixed amount of memory. Percentiles are the upper bound of the bucket they fall in.
+class TRACEANDSWEEPCOLLISION_API FCollisionTelemetryHistogram
+{
+public:
+	FCollisionTelemetryHistogram();
+
+	void Add(double value);
+	void Reset();
+
+	// Percentile in [0, 100], 0 if nothing was added
+	double GetPercentile(double percentile) const;
+
+	FORCEINLINE int64 Num() const { return m_num_values; }
+	FORCEINLINE double GetMax() const { return m_max_value; }
+	FORCEINLINE double GetMean() const { return m_num_values > 0 ? m_sum / m_num_values : 0.0; }
+
+private:
+	static constexpr int32 num_buckets = 128;
+	// Upper bound of first bucket and ratio between bounds of neighbouring buckets, last bucket holds everything above ~0.1 * 1.15^127
+	static constexpr double first_bucket_bound = 0.1;
+	static constexpr double bucket_ratio = 1.15;
+
+	int64 m_counts[num_buckets];
+	int64 m_num_values = 0;
+	double m_sum = 0.0;
+	double m_max_value = 0.0;
+};
+
+// Counters and histograms of one manager. Only touched on game thread.
+class TRACEANDSWEEPCOLLISION_API FCollisionTelemetry
+{
+public:
+	// Index of the counters of owner class, stays valid until Reset
+	int32 FindOrAddArchetype(const UClass* owner_class);
+	FORCEINLINE FCollisionTelemetryCounters& GetCounters(int32 archetype) { return m_archetypes[archetype]; }
+
+	void AddTickCost(double seconds);
+	void AddAsyncLatency(double seconds);
+
+	// Async traces that were started and haven't been handed to their component yet
+	FORCEINLINE void AddAsyncInFlight(int32 count) { m_num_async_in_flight += count; m_max_async_in_flight = FMath::Max(m_max_async_in_flight, m_num_async_in_flight); }
+
+	// Clears the counters of every archetype, indices already handed out stay valid
+	void Reset();
+
+	// Writes a summary with one line per archetype, most expensive first
+	void Dump(FOutputDevice& ar) const;
+
+	// One metric per row as metric,name,value so it can be appended and pivoted easily. Returns false if file couldn't be written.
+	bool WriteCsv(const FString& path) const;
+
+private:
+	// By path name of owner class
+	TMap<FName, int32> m_archetype_indices;
+	TArray<FCollisionTelemetryCounters> m_archetypes;
+
+	// Microseconds of manager tick on game thread
+	FCollisionTelemetryHistogram m_tick_cost_us;
+	// Milliseconds from starting an async trace to handing its result to the component
+	FCollisionTelemetryHistogram m_async_latency_ms;
+
+	int32 m_num_async_in_flight = 0;
+	int32 m_max_async_in_flight = 0;
+
+	double m_reset_seconds = FPlatformTime::Seconds();
+};
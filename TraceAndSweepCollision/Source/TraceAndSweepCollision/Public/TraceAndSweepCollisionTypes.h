@@ -1,8 +1,15 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Engine/HitResult.h"
+#include "UObject/ObjectKey.h"
+#include "Templates/UniquePtr.h"
+#include <atomic>
 #include "TraceAndSweepCollisionTypes.generated.h"
 
+class AActor;
+class UPrimitiveComponent;
+
 UENUM(BlueprintType)
 enum class ECollisionCompExecutionType : uint8
 {
@@ -33,6 +40,16 @@ enum class ECollisionCompChannelType : uint8
 	COLLISION_PRESET UMETA(DisplayName = "Collision Preset")
 };
 
+UENUM(BlueprintType)
+enum class ECollisionCompEndOverlapType : uint8
+{
+	// Trace every segment again from end to start, objects hit on the way back were left
+	REVERSE_TRACE = 0 UMETA(DisplayName = "Reverse Trace"),
+	// No extra trace, overlap ends on the first collision test where none of the forward traces touch the object.
+	// Relies on forward traces returning objects they start inside of, so use it with multi sweeps.
+	FORWARD_DIFF UMETA(DisplayName = "Forward Diff")
+};
+
 UENUM(BlueprintType)
 enum class ECollisionCompShapeType : uint8
 {
@@ -55,6 +72,10 @@ public:
 	USceneComponent* m_scene_component_to_follow = nullptr;
 
 	FVector m_prev_location = FVector::ZeroVector;
+
+	// Resolved from socket name when parent mesh changes. Bone the socket is attached to and socket transform relative to that bone (identity if name is a bone).
+	int32 m_bone_index = INDEX_NONE;
+	FTransform m_socket_local_transform = FTransform::Identity;
 	
 	// Handle for asynchronous tracing
 	FTraceHandle m_forward_trace_handle = FTraceHandle();
@@ -97,4 +118,237 @@ public:
 	// Handle for asynchronous tracing
 	FTraceHandle m_forward_trace_handle = FTraceHandle();
 	FTraceHandle m_reverse_trace_handle = FTraceHandle();
-};
\ No newline at end of file
+};
+
+// Start and end of a single line or shape for one collision test.
+// Built on game thread and then consumed by the trace queries, which may run on any thread.
+struct TRACEANDSWEEPCOLLISION_API FCollisionTraceSegment
+{
+	// Index into line data or shape data of the owning component
+	int32 m_data_index = INDEX_NONE;
+
+	FVector m_start = FVector::ZeroVector;
+	FVector m_end = FVector::ZeroVector;
+
+	// Only used for sweeps
+	FQuat m_start_rotation = FQuat::Identity;
+	FQuat m_end_rotation = FQuat::Identity;
+
+	// Radius of sphere that encloses the shape, zero for lines
+	float m_radius = 0.0f;
+};
+
+// World space capsule that stands in for a line or shape when components are tested against each other. Sphere when both points are same.
+struct TRACEANDSWEEPCOLLISION_API FCollisionComponentCapsule
+{
+	FVector m_point_a = FVector::ZeroVector;
+	FVector m_point_b = FVector::ZeroVector;
+	float m_radius = 0.0f;
+};
+
+// Splits a sweep that moves or turns too much in one collision test into sub steps.
+// Sub steps follow the rigid motion from start to end pose (rotation about an axis plus slide along it),
+// so a shape swung around a pivot sweeps along the arc instead of the straight chord between its end points.
+struct TRACEANDSWEEPCOLLISION_API FCollisionSubStepSettings
+{
+	// Maximum rotation in degrees of one sub step, 0 to ignore rotation
+	float m_max_angle = 0.0f;
+	// Maximum distance of one sub step, 0 to ignore distance
+	float m_max_distance = 0.0f;
+	int32 m_max_sub_steps = 1;
+
+	FORCEINLINE bool IsEnabled() const { return m_max_sub_steps > 1 && (m_max_angle > 0.0f || m_max_distance > 0.0f); }
+
+	// Appends segment, or its sub steps if it moves more than allowed for one step
+	void AppendSegments(const FCollisionTraceSegment& segment, TArray<FCollisionTraceSegment>& out_segments) const;
+};
+
+// Identifies what a hit result hit. Two hits are the same overlap if actor, component and item are same.
+struct TRACEANDSWEEPCOLLISION_API FCollisionHitKey
+{
+	TObjectKey<AActor> m_actor;
+	TObjectKey<UPrimitiveComponent> m_component;
+	int32 m_item = INDEX_NONE;
+
+	FCollisionHitKey() = default;
+	explicit FCollisionHitKey(const FHitResult& result);
+
+	bool operator==(const FCollisionHitKey& rhs) const
+	{
+		return m_actor == rhs.m_actor && m_component == rhs.m_component && m_item == rhs.m_item;
+	}
+
+	friend uint32 GetTypeHash(const FCollisionHitKey& key)
+	{
+		return HashCombine(HashCombine(GetTypeHash(key.m_actor), GetTypeHash(key.m_component)), ::GetTypeHash(key.m_item));
+	}
+};
+
+// Parts of a hit result that overlap tracking needs, a fraction of the size of FHitResult.
+// Full hit result is only kept for hits that begin an overlap, since that is the only place it is handed out.
+struct TRACEANDSWEEPCOLLISION_API FCollisionHitRecord
+{
+	TWeakObjectPtr<UPrimitiveComponent> m_component;
+	int32 m_item = INDEX_NONE;
+	float m_distance = 0.0f;
+	FVector m_impact_point = FVector::ZeroVector;
+	FVector m_impact_normal = FVector::ZeroVector;
+
+	FCollisionHitRecord() = default;
+	explicit FCollisionHitRecord(const FHitResult& result);
+
+	// Blocking hit result with what the record has, used when full result of the hit wasn't kept
+	FHitResult MakeHitResult() const;
+};
+
+struct TRACEANDSWEEPCOLLISION_API FCollisionHitEntry
+{
+	FCollisionHitKey m_key;
+	int32 m_count = 0;
+	FCollisionHitRecord m_record;
+	// Index of full hit result kept by owner of the set, INDEX_NONE if only the record was kept
+	int32 m_result_index = INDEX_NONE;
+};
+
+// Set of hit results keyed on what was hit, with a reference count for each hit.
+// Entries are stored densely and a hash map points into them, so insert, lookup and decrement are constant time.
+class TRACEANDSWEEPCOLLISION_API FCollisionHitSet
+{
+public:
+	// Returns entry of the hit, adding it with count of 0 if it isn't in the set. out_is_new is true if hit was added.
+	FCollisionHitEntry& FindOrAdd(const FHitResult& result, bool& out_is_new);
+	FCollisionHitEntry& FindOrAdd(const FCollisionHitKey& key, const FCollisionHitRecord& record, bool& out_is_new);
+
+	// Adds the hit only if it isn't in the set already. Returns true if hit was added.
+	bool AddUnique(const FHitResult& result);
+
+	FCollisionHitEntry* Find(const FCollisionHitKey& key);
+
+	// Decrements count of the hit. When count reaches zero hit is removed and true is returned.
+	bool Release(const FCollisionHitKey& key);
+
+	void Remove(const FCollisionHitKey& key);
+
+	// Removes all the entries but keeps the memory
+	void Reset();
+
+	FORCEINLINE int32 Num() const { return m_entries.Num(); }
+
+	// NOTE: Order of entries changes when an entry is removed
+	FORCEINLINE const TArray<FCollisionHitEntry>& GetEntries() const { return m_entries; }
+
+private:
+	void RemoveAt(int32 index);
+
+	TArray<FCollisionHitEntry> m_entries;
+	TMap<FCollisionHitKey, int32> m_indices;
+};
+
+// Structure of arrays storage for previous and current transforms of lines and shapes of many components.
+// Each line or shape gets a slot, and hot per tick data of all slots lives in a few contiguous arrays
+// so that computing start and end of every segment is a linear pass instead of going through each component.
+class TRACEANDSWEEPCOLLISION_API FCollisionTracePool
+{
+public:
+	int32 AllocateSlot(int32 owner, int32 data_index);
+	void FreeSlot(int32 slot);
+
+	FORCEINLINE void SetOwner(int32 slot, int32 owner) { m_owners[slot] = owner; }
+	FORCEINLINE void SetExtent(int32 slot, const FVector& extent) { m_extents[slot] = extent; }
+	FORCEINLINE void SetSubStepSettings(int32 slot, const FCollisionSubStepSettings& settings) { m_sub_step_settings[slot] = settings; }
+	FORCEINLINE void SetPrevious(int32 slot, const FVector& location, const FQuat& rotation)
+	{
+		m_prev_locations[slot] = location;
+		m_prev_rotations[slot] = rotation;
+	}
+
+	// Sets current transform of the slot and marks it to be traced
+	FORCEINLINE void SetCurrent(int32 slot, const FVector& location, const FQuat& rotation)
+	{
+		m_curr_locations[slot] = location;
+		m_curr_rotations[slot] = rotation;
+		m_is_due[slot] = 1;
+	}
+
+	FORCEINLINE const FVector& GetPreviousLocation(int32 slot) const { return m_prev_locations[slot]; }
+	FORCEINLINE const FQuat& GetPreviousRotation(int32 slot) const { return m_prev_rotations[slot]; }
+	FORCEINLINE const FVector& GetExtent(int32 slot) const { return m_extents[slot]; }
+	FORCEINLINE int32 GetOwner(int32 slot) const { return m_owners[slot]; }
+	FORCEINLINE int32 Num() const { return m_owners.Num(); }
+
+	// Moves current transform into previous for the due slots without making segments
+	void CommitSlots(TConstArrayView<int32> slots);
+
+	// Makes a segment from previous to current transform for each due slot and then moves current transform into previous
+	void SweepSlots(TConstArrayView<int32> slots, TArray<FCollisionTraceSegment>& out_segments);
+
+	// Same as SweepSlots but goes over the whole pool in one pass. Also returns owner of each segment.
+	void SweepAllSlots(TArray<FCollisionTraceSegment>& out_segments, TArray<int32>& out_owners);
+
+private:
+	void SweepSlot(int32 slot, TArray<FCollisionTraceSegment>& out_segments);
+
+	TArray<FVector> m_prev_locations;
+	TArray<FVector> m_curr_locations;
+	TArray<FQuat> m_prev_rotations;
+	TArray<FQuat> m_curr_rotations;
+
+	// Box half extent, (radius, radius, half height) for capsule, radius on all axis for sphere and zero for lines
+	TArray<FVector> m_extents;
+	TArray<FCollisionSubStepSettings> m_sub_step_settings;
+
+	// Index of owning component in manager and index of line or shape data in that component
+	TArray<int32> m_owners;
+	TArray<int32> m_data_indices;
+
+	// Set when current transform is updated and cleared when segment is made
+	TArray<uint8> m_is_due;
+
+	TArray<int32> m_free_slots;
+};
+
+// Completed async trace waiting in FCollisionAsyncTraceQueue to be handed to its component
+struct FCollisionAsyncTraceRecord
+{
+	uint64 m_handle = 0;
+	// User data the trace was started with, tells manager which component it belongs to
+	uint32 m_route = 0;
+
+	// Needed only for debug drawing
+	FVector m_start = FVector::ZeroVector;
+	FVector m_end = FVector::ZeroVector;
+	FQuat m_rotation = FQuat::Identity;
+
+	// Allocation is kept when the record is reused, so it only grows up to largest multi trace result
+	TArray<FHitResult> m_hits;
+};
+
+// Fixed capacity multiple producer single consumer ring of completed async traces.
+// Producers reserve a record with a compare and swap and publish it with a sequence number, so pushing never locks,
+// and records are reused in place so after warm up it never allocates either.
+class TRACEANDSWEEPCOLLISION_API FCollisionAsyncTraceQueue
+{
+public:
+	// Capacity is rounded up to power of two. Not thread safe, has to be called before any push.
+	void Init(int32 capacity, int32 hits_per_record);
+
+	FORCEINLINE bool IsInitialized() const { return m_records.Num() > 0; }
+
+	// Returns false if queue is full, in which case caller has to handle the trace itself
+	bool Push(uint64 handle, uint32 route, const FVector& start, const FVector& end, const FQuat& rotation, TConstArrayView<FHitResult> hits);
+
+	// Consumer only. Adds every published record in order they were pushed. Records stay valid and untouched by producers until Release.
+	void Acquire(TArray<const FCollisionAsyncTraceRecord*>& out_records);
+
+	// Consumer only. Gives first num_records acquired records back to producers.
+	void Release(int32 num_records);
+
+private:
+	TArray<FCollisionAsyncTraceRecord> m_records;
+	// Per record sequence, equals push position when record is free and push position + 1 when it is published
+	TUniquePtr<std::atomic<uint32>[]> m_sequences;
+	uint32 m_mask = 0;
+
+	std::atomic<uint32> m_push_position = 0;
+	uint32 m_pop_position = 0;
+};
@@ -35,7 +35,8 @@ public class TraceAndSweepCollision : ModuleRules
 			new string[]
 			{
 				"CoreUObject",
-				"Engine"
+				"Engine",
+				"RenderCore"
 				// ... add private dependencies that you statically link with here ...	
 			}
 			);